@@ -0,0 +1,306 @@
+#ifndef TESTABLE_ACTOR_SINGLETON_INCLUDED_H
+#define TESTABLE_ACTOR_SINGLETON_INCLUDED_H
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <exception>
+#include <functional>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <new>
+#include <thread>
+#include <utility>
+
+/// Implements a singleton whose instance is owned by a single, dedicated thread.
+/** Unlike `Singleton<T>`, the instance of an actor singleton is never accessed directly by its
+  * callers. Instead, operations are sent to the owner thread, which executes them one after the
+  * other. This avoids guarding the state of `T` with a mutex, and keeps it in the cache of the
+  * core running the owner thread, even under heavy write load. Inherit from it with the CRTP
+  * style, like:
+  *
+  * ```cpp
+  * class MyClass : public ActorSingleton<MyClass> { impl... };
+  *
+  * MyClass::Post([](MyClass& self) { self.Update(); });
+  * std::future<int> result = MyClass::Call([](MyClass& self) { return self.Query(); });
+  * ```
+  *
+  * The owner thread is started and `T` is default-constructed on it when the first operation is
+  * sent. Operations are passed through a lock-free multiple-producer single-consumer queue, which
+  * the owner thread drains without taking any lock. The owner thread only sleeps when the queue
+  * is empty, and the producer and consumer ends of the queue are kept on separate cache lines. At
+  * program exit, the queued operations are completed, then the instance is destroyed on the owner
+  * thread.
+  *
+  * To test your actor, use an access-private library (see `Singleton<T>`) to invoke the
+  * `MyClass::RunInline()` function, which makes operations run synchronously on the calling
+  * thread, and the `MyClass::Inject()` function to replace the instance with a mock.
+  *
+  * @remark The `Inject()` and `RunInline()` functions are NOT thread safe! They should only be
+  *         used in test code sections while no operations are queued or running.
+  */
+template <typename T>
+struct ActorSingleton
+{
+    using BaseType = ActorSingleton<T>;
+
+    /// Sends an operation to the owner thread without waiting for it.
+    /** @param op A copyable callable with a `void(T&)` compatible signature. It must not throw;
+      *           an exception escaping it on the owner thread calls `std::terminate()`.
+      */
+    template <typename F>
+    static void Post(F op)
+    {
+        GetActor().Push(Operation(std::move(op)));
+    }
+
+    /// Sends an operation to the owner thread, and returns a future for its result.
+    /** @param op A copyable callable with an `R(T&)` compatible signature. Exceptions thrown by it
+      *           are forwarded to the returned future.
+      * @remark Waiting for the future from an operation that runs on the owner thread (such as
+      *         `Call(...).get()` inside another `Call()`) deadlocks, because the owner thread
+      *         would wait for itself. Use `Post()` or nest the operations instead.
+      */
+    template <typename F>
+    static std::future<decltype(std::declval<F&>()(std::declval<T&>()))> Call(F op)
+    {
+        using Result = decltype(std::declval<F&>()(std::declval<T&>()));
+        std::shared_ptr<std::promise<Result>> promise = std::make_shared<std::promise<Result>>();
+        std::future<Result> result = promise->get_future();
+        GetActor().Push([promise, op](T& instance) mutable {
+                Fulfill(*promise, op, instance);
+            });
+        return result;
+    }
+
+protected:
+    ActorSingleton() noexcept = default;
+private:
+    ActorSingleton(const ActorSingleton&) = delete;
+    ActorSingleton& operator =(const ActorSingleton&) = delete;
+
+    /// The type-erased operation that is executed on the owner thread.
+    using Operation = std::function<void(T&)>;
+
+    /// Sets the result of `op` into `promise`.
+    template <typename Result, typename F>
+    static void Fulfill(std::promise<Result>& promise, F& op, T& instance)
+    {
+        try
+        {
+            promise.set_value(op(instance));
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+    }
+    /// Sets the completion of `op` into `promise`.
+    template <typename F>
+    static void Fulfill(std::promise<void>& promise, F& op, T& instance)
+    {
+        try
+        {
+            op(instance);
+            promise.set_value();
+        }
+        catch (...)
+        {
+            promise.set_exception(std::current_exception());
+        }
+    }
+
+    /// Owns the instance of T, the owner thread and the queue of operations sent to it.
+    class Actor final
+    {
+    public:
+        Actor()
+            : m_head(new Node), m_tail(m_head.load(std::memory_order_relaxed))
+        {
+        }
+        Actor(const Actor&) = delete;
+        ~Actor()
+        {
+            if (m_thread.joinable())
+            {
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_stopping = true;
+                }
+                m_wake.notify_one();
+                m_thread.join();
+            }
+            while (Node* node = m_tail)
+            {
+                m_tail = node->next.load(std::memory_order_relaxed);
+                delete node;
+            }
+            Destroy();
+        }
+        Actor& operator =(const Actor&) = delete;
+
+        /// Enqueues an operation for the owner thread, or runs it in inline mode.
+        void Push(Operation op)
+        {
+            if (m_inline)
+            {
+                op(Instance());
+                return;
+            }
+            std::call_once(m_started, [this]() { m_thread = std::thread(&Actor::Run, this); });
+
+            Node* node = new Node;
+            node->op = std::move(op);
+            // Producers serialize on the head; the consumer sees the node after it is linked.
+            Node* prev = m_head.exchange(node, std::memory_order_acq_rel);
+            prev->next.store(node, std::memory_order_seq_cst);
+            // Pairs with the consumer storing `m_sleeping`, then checking for new nodes.
+            if (m_sleeping.load(std::memory_order_seq_cst))
+            {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_wake.notify_one();
+            }
+        }
+
+        /// Sets an external object as the instance, destroying the local one.
+        void SetExtern(T* ptr)
+        {
+            Destroy();
+            m_pExtern = ptr;
+        }
+
+        /// Enables or disables running the operations on the caller's thread.
+        void SetInline(bool enable)
+        {
+            m_inline = enable;
+        }
+    private:
+        /// A node of the intrusive multiple-producer single-consumer queue.
+        struct Node
+        {
+            std::atomic<Node*> next{ nullptr };
+            Operation op;
+        };
+
+        /// The size of the cache lines that the producers and the consumer write separately.
+        enum : std::size_t { CACHE_LINE_SIZE = 64 };
+
+        /// The main loop of the owner thread.
+        /** It executes the queued operations until the queue is empty, then sleeps until a new
+          * operation is pushed, or the actor is stopped.
+          */
+        void Run()
+        {
+            for (;;)
+            {
+                Drain();
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_sleeping.store(true, std::memory_order_seq_cst);
+                m_wake.wait(lock, [this]() { return HasWork() || m_stopping; });
+                m_sleeping.store(false, std::memory_order_relaxed);
+                if (!HasWork())
+                    break;
+            }
+            // Destroy the instance on the thread that constructed and used it.
+            Destroy();
+        }
+
+        /// Returns whether an operation is waiting in the queue.
+        bool HasWork() const
+        {
+            return m_tail->next.load(std::memory_order_seq_cst) != nullptr;
+        }
+
+        /// Executes the queued operations on the owner thread, until the queue is empty.
+        void Drain()
+        {
+            while (Node* next = m_tail->next.load(std::memory_order_acquire))
+            {
+                // The consumed node becomes the new stub of the queue.
+                Operation op = std::move(next->op);
+                delete m_tail;
+                m_tail = next;
+                op(Instance());
+            }
+        }
+
+        /// Returns the current instance, constructing the local one if needed.
+        T& Instance()
+        {
+            if (m_pExtern)
+                return *m_pExtern;
+            if (!m_constructed)
+            {
+                new (&m_buffer.asT) T();
+                m_constructed = true;
+            }
+            return m_buffer.asT;
+        }
+
+        /// Destroys the locally-constructed instance. Injected ones are ignored (no ownership).
+        void Destroy()
+        {
+            if (m_constructed)
+            {
+                m_buffer.asT.~T();
+                m_constructed = false;
+            }
+        }
+
+        // The members are grouped by their writers, so that writing one group does not evict
+        // the cache lines of the others from the cores of the readers.
+
+        /// The most recently pushed node; written by the producers.
+        alignas(CACHE_LINE_SIZE) std::atomic<Node*> m_head;
+
+        /// The stub node preceding the next operation; only used by the consumer.
+        alignas(CACHE_LINE_SIZE) Node* m_tail;
+        /// An injected instance, or nullptr to use the local one.
+        T* m_pExtern = nullptr;
+        bool m_constructed = false;
+
+        /// Set while the owner thread waits on `m_wake`; read by the producers on every push.
+        alignas(CACHE_LINE_SIZE) std::atomic<bool> m_sleeping{ false };
+        bool m_inline = false;
+        std::once_flag m_started;
+        /// Guards `m_stopping` and sleeping on `m_wake`.
+        std::mutex m_mutex;
+        std::condition_variable m_wake;
+        bool m_stopping = false;
+        std::thread m_thread;
+
+        /// Uninitialized buffer for the locally constructed instance.
+        alignas(CACHE_LINE_SIZE) union U { T asT; U(){} ~U(){} } m_buffer;
+    };
+
+    /// Returns the actor, which is created on first use.
+    static Actor& GetActor()
+    {
+        static Actor actor;
+        return actor;
+    }
+
+    /// Injects an external instance into the actor.
+    /** Operations sent after this call are executed on `object`. The locally constructed instance
+      * is destroyed.
+      * @param object The object is taken without ownership and must be deleted by the caller.
+      * @remark If `object` is `nullptr`, the next operation reconstructs the local instance.
+      */
+    static void Inject(T* object)
+    {
+        GetActor().SetExtern(object);
+    }
+
+    /// Makes operations run synchronously on the calling thread, instead of the owner thread.
+    /** In inline mode, `Post()` returns after the operation is executed, and `Call()` returns a
+      * ready future.
+      */
+    static void RunInline(bool enable)
+    {
+        GetActor().SetInline(enable);
+    }
+};
+
+#endif
@@ -0,0 +1,512 @@
+#ifndef TESTABLE_REMOTE_SINGLETON_INCLUDED_H
+#define TESTABLE_REMOTE_SINGLETON_INCLUDED_H
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <future>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "singleton.hpp"
+
+#ifndef REMOTE_SINGLETON_MAX_PAYLOAD_SIZE
+/// The maximal size of a request or response payload in bytes.
+#define REMOTE_SINGLETON_MAX_PAYLOAD_SIZE (1u << 30)
+#endif
+
+/// A pipelined connection to a `RemoteServer` over a Unix domain socket.
+/** Any number of calls may be outstanding on the channel at the same time; their responses are
+  * matched to them by identifiers. Calls made while another thread is sending are appended to a
+  * batch, which is then sent with a single system call. Likewise, the responses are received in
+  * batches by a background thread.
+  *
+  * @remark This header requires POSIX sockets.
+  */
+class RemoteChannel final
+{
+public:
+    /// Connects to the server listening on `socketPath`.
+    /** @throw std::system_error If the connection fails.
+      */
+    explicit RemoteChannel(const std::string& socketPath)
+        : m_socket(Connect(socketPath))
+    {
+        m_receiver = std::thread(&RemoteChannel::Receive, this);
+    }
+    RemoteChannel(const RemoteChannel&) = delete;
+    ~RemoteChannel()
+    {
+        shutdown(m_socket, SHUT_RDWR);
+        m_receiver.join();
+        close(m_socket);
+    }
+    RemoteChannel& operator =(const RemoteChannel&) = delete;
+
+    /// Sends a request to the server without waiting for the response.
+    /** @param method The server-defined identifier of the operation.
+      * @param payload The server-defined encoding of the arguments.
+      * @return The future of the response payload. If the server failed to handle the request, or
+      *         the connection is lost, it holds an exception. If the payload is larger than
+      *         `REMOTE_SINGLETON_MAX_PAYLOAD_SIZE`, it holds a `std::length_error`.
+      */
+    std::future<std::string> Call(std::uint32_t method, const std::string& payload)
+    {
+        std::promise<std::string> promise;
+        std::future<std::string> result = promise.get_future();
+        if (payload.size() > MAX_PAYLOAD_SIZE)
+        {
+            promise.set_exception(std::make_exception_ptr(
+                std::length_error("RemoteChannel: the request payload is too large")));
+            return result;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        if (m_broken)
+        {
+            promise.set_exception(std::make_exception_ptr(
+                std::system_error(ENOTCONN, std::generic_category(), "RemoteChannel")));
+            return result;
+        }
+        const std::uint64_t id = m_nextId++;
+        m_pending.emplace(id, std::move(promise));
+        AppendFrame(m_output, method, id, payload);
+        if (m_sending)
+            return result; // The sending thread picks up the request with its next batch.
+
+        m_sending = true;
+        while (!m_output.empty())
+        {
+            std::string batch;
+            batch.swap(m_output);
+            lock.unlock();
+            const bool sent = SendAll(m_socket, batch);
+            lock.lock();
+            if (!sent)
+            {
+                m_output.clear();
+                FailPending(lock);
+            }
+        }
+        m_sending = false;
+        return result;
+    }
+
+    /// Returns whether the connection is lost. All calls on a broken channel fail.
+    bool IsBroken()
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        return m_broken;
+    }
+private:
+    // The server shares the wire format helpers below.
+    friend class RemoteServer;
+
+    /// Status codes of responses.
+    enum Status : std::uint32_t
+    {
+        OK,
+        FAILED,
+    };
+
+    /// Appends an encoded request or response to `buffer`.
+    static void AppendFrame(
+        std::string& buffer, std::uint32_t code, std::uint64_t id, const std::string& payload)
+    {
+        Header header = { static_cast<std::uint32_t>(payload.size()), code, id };
+        buffer.append(reinterpret_cast<const char*>(&header), sizeof(header));
+        buffer.append(payload);
+    }
+
+    /// Removes the complete frames from the beginning of `buffer`, passing them to `callback`.
+    /** @return False if the buffer holds an invalid frame.
+      */
+    template <typename Callback>
+    static bool ParseFrames(std::string& buffer, Callback callback)
+    {
+        std::size_t offset = 0;
+        while (buffer.size() - offset >= sizeof(Header))
+        {
+            Header header;
+            std::memcpy(&header, buffer.data() + offset, sizeof(header));
+            if (header.size > MAX_PAYLOAD_SIZE)
+                return false;
+            if (buffer.size() - offset - sizeof(header) < header.size)
+                break;
+            callback(header.code, header.id, buffer.substr(offset + sizeof(header), header.size));
+            offset += sizeof(header) + header.size;
+        }
+        buffer.erase(0, offset);
+        return true;
+    }
+
+    /// Receives the available data from `fd` into `buffer`.
+    /** @return False if the connection is closed or failed.
+      */
+    static bool ReceiveSome(int fd, std::string& buffer)
+    {
+        char chunk[64 * 1024];
+        for (;;)
+        {
+            ssize_t received = recv(fd, chunk, sizeof(chunk), 0);
+            if (received > 0)
+            {
+                buffer.append(chunk, static_cast<std::size_t>(received));
+                return true;
+            }
+            if (received == 0 || errno != EINTR)
+                return false;
+        }
+    }
+
+    /// Sends all of `data` to `fd`.
+    /** @return False if the connection is closed or failed.
+      */
+    static bool SendAll(int fd, const std::string& data)
+    {
+#ifdef MSG_NOSIGNAL
+        const int flags = MSG_NOSIGNAL;
+#else
+        const int flags = 0;
+#endif
+        std::size_t offset = 0;
+        while (offset < data.size())
+        {
+            ssize_t sent = send(fd, data.data() + offset, data.size() - offset, flags);
+            if (sent < 0 && errno == EINTR)
+                continue;
+            if (sent <= 0)
+                return false;
+            offset += static_cast<std::size_t>(sent);
+        }
+        return true;
+    }
+
+    /// Fills `address` with the Unix domain socket address of `socketPath`.
+    static void MakeAddress(const std::string& socketPath, sockaddr_un& address)
+    {
+        if (socketPath.size() >= sizeof(address.sun_path))
+            throw std::system_error(ENAMETOOLONG, std::generic_category(), socketPath);
+        std::memset(&address, 0, sizeof(address));
+        address.sun_family = AF_UNIX;
+        std::memcpy(address.sun_path, socketPath.c_str(), socketPath.size() + 1);
+    }
+
+    /// Creates a Unix domain stream socket that does not raise `SIGPIPE`.
+    static int CreateSocket()
+    {
+        int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        if (fd == -1)
+            throw std::system_error(errno, std::generic_category(), "socket");
+        fcntl(fd, F_SETFD, FD_CLOEXEC);
+#ifdef SO_NOSIGPIPE
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_NOSIGPIPE, &on, sizeof(on));
+#endif
+        return fd;
+    }
+
+    /// The header of the frames in both directions.
+    struct Header
+    {
+        /// The size of the payload following the header.
+        std::uint32_t size;
+        /// The method of a request, or the `Status` of a response.
+        std::uint32_t code;
+        /// Matches a response to its request.
+        std::uint64_t id;
+    };
+    enum : std::uint32_t { MAX_PAYLOAD_SIZE = REMOTE_SINGLETON_MAX_PAYLOAD_SIZE };
+
+    static int Connect(const std::string& socketPath)
+    {
+        sockaddr_un address;
+        MakeAddress(socketPath, address);
+        int fd = CreateSocket();
+        if (connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1)
+        {
+            int error = errno;
+            close(fd);
+            throw std::system_error(error, std::generic_category(), socketPath);
+        }
+        return fd;
+    }
+
+    /// The main loop of the receiver thread.
+    void Receive()
+    {
+        std::string buffer;
+        while (ReceiveSome(m_socket, buffer))
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            bool valid = ParseFrames(buffer,
+                [this](std::uint32_t status, std::uint64_t id, std::string payload) {
+                    auto it = m_pending.find(id);
+                    if (it == m_pending.end())
+                        return;
+                    if (status == OK)
+                        it->second.set_value(std::move(payload));
+                    else
+                        it->second.set_exception(std::make_exception_ptr(
+                            std::runtime_error(payload)));
+                    m_pending.erase(it);
+                });
+            if (!valid)
+                break;
+        }
+        std::unique_lock<std::mutex> lock(m_mutex);
+        FailPending(lock);
+    }
+
+    /// Marks the channel as broken and fails all outstanding calls.
+    void FailPending(std::unique_lock<std::mutex>&)
+    {
+        m_broken = true;
+        for (auto& pending : m_pending)
+            pending.second.set_exception(std::make_exception_ptr(
+                std::system_error(ECONNRESET, std::generic_category(), "RemoteChannel")));
+        m_pending.clear();
+    }
+
+    const int m_socket;
+    std::thread m_receiver;
+    /// Guards the members below.
+    std::mutex m_mutex;
+    std::uint64_t m_nextId = 0;
+    std::unordered_map<std::uint64_t, std::promise<std::string>> m_pending;
+    /// The requests waiting to be sent by the sending thread.
+    std::string m_output;
+    bool m_sending = false;
+    bool m_broken = false;
+};
+
+/// Hosts the backend of remote singletons, serving `RemoteChannel` connections.
+/** The server can be run in a sidecar process, so that a single instance of a large state is
+  * shared by the worker processes of a host. The requests received together on a connection
+  * are handled in order, and their responses are sent back together. Each connection is served
+  * by its own thread. The threads of closed connections are joined when the next connection is
+  * accepted, so they do not accumulate in a long-running server.
+  *
+  * @remark The handler is called concurrently from the threads serving different connections.
+  */
+class RemoteServer final
+{
+public:
+    /// Handles a request, returning the response payload or throwing an exception.
+    using Handler = std::function<std::string(std::uint32_t method, const std::string& payload)>;
+
+    /// Starts listening on `socketPath`, replacing an existing socket file.
+    /** @throw std::system_error If the socket cannot be created.
+      */
+    RemoteServer(const std::string& socketPath, Handler handler)
+        : m_socketPath(socketPath), m_handler(std::move(handler))
+    {
+        sockaddr_un address;
+        RemoteChannel::MakeAddress(socketPath, address);
+        m_listener = RemoteChannel::CreateSocket();
+        unlink(socketPath.c_str());
+        if (bind(m_listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) == -1 ||
+            listen(m_listener, SOMAXCONN) == -1 || pipe(m_wakeup) == -1)
+        {
+            int error = errno;
+            close(m_listener);
+            throw std::system_error(error, std::generic_category(), socketPath);
+        }
+        m_acceptor = std::thread(&RemoteServer::Accept, this);
+    }
+    RemoteServer(const RemoteServer&) = delete;
+    /// Stops the server, closing the connections.
+    ~RemoteServer()
+    {
+        close(m_wakeup[1]);
+        m_acceptor.join();
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            for (auto& connection : m_connections)
+                if (!connection.finished)
+                    shutdown(connection.socket, SHUT_RDWR);
+        }
+        // No connections are added anymore, so the list can be accessed without the lock.
+        for (auto& connection : m_connections)
+            connection.thread.join();
+        close(m_wakeup[0]);
+        close(m_listener);
+        unlink(m_socketPath.c_str());
+    }
+    RemoteServer& operator =(const RemoteServer&) = delete;
+private:
+    /// A connection and the thread serving it.
+    struct Connection
+    {
+        int socket;
+        std::thread thread;
+        /// Set by the serving thread when the connection is closed.
+        bool finished;
+    };
+
+    /// The main loop of the accepting thread.
+    void Accept()
+    {
+        pollfd fds[2] = { { m_listener, POLLIN, 0 }, { m_wakeup[0], POLLIN, 0 } };
+        for (;;)
+        {
+            if (poll(fds, 2, -1) == -1)
+            {
+                // The events are unspecified after a failure.
+                if (errno == EINTR)
+                    continue;
+                break;
+            }
+            if (fds[1].revents)
+                break;
+            if (!(fds[0].revents & POLLIN))
+                continue;
+            int connection = accept(m_listener, nullptr, nullptr);
+            if (connection == -1)
+                continue;
+            std::lock_guard<std::mutex> lock(m_mutex);
+            JoinFinished();
+            m_connections.push_back(Connection{ connection, std::thread(), false });
+            m_connections.back().thread =
+                std::thread(&RemoteServer::Serve, this, &m_connections.back());
+        }
+    }
+
+    /// Joins the threads of the closed connections, and removes their records.
+    /** @remark Must be called with `m_mutex` locked.
+      */
+    void JoinFinished()
+    {
+        for (auto it = m_connections.begin(); it != m_connections.end();)
+        {
+            if (it->finished)
+            {
+                // The thread is about to return, after setting the flag.
+                it->thread.join();
+                it = m_connections.erase(it);
+            }
+            else
+            {
+                ++it;
+            }
+        }
+    }
+
+    /// Serves the requests of a connection.
+    void Serve(Connection* record)
+    {
+        const int connection = record->socket;
+        std::string input, output;
+        while (RemoteChannel::ReceiveSome(connection, input))
+        {
+            bool valid = RemoteChannel::ParseFrames(input,
+                [this, &output](std::uint32_t method, std::uint64_t id, std::string payload) {
+                    try
+                    {
+                        std::string response = m_handler(method, payload);
+                        // An oversized frame would break the stream for every other call.
+                        if (response.size() > RemoteChannel::MAX_PAYLOAD_SIZE)
+                            throw std::length_error("RemoteServer: the response is too large");
+                        RemoteChannel::AppendFrame(output, RemoteChannel::OK, id, response);
+                    }
+                    catch (const std::exception& e)
+                    {
+                        RemoteChannel::AppendFrame(output, RemoteChannel::FAILED, id, e.what());
+                    }
+                    catch (...)
+                    {
+                        RemoteChannel::AppendFrame(
+                            output, RemoteChannel::FAILED, id, "Unknown exception");
+                    }
+                });
+            if (!valid || !RemoteChannel::SendAll(connection, output))
+                break;
+            output.clear();
+        }
+        // The socket is closed under the lock, so that it is not shut down after its reuse.
+        std::lock_guard<std::mutex> lock(m_mutex);
+        close(connection);
+        record->finished = true;
+    }
+
+    const std::string m_socketPath;
+    const Handler m_handler;
+    int m_listener = -1;
+    /// Closing the write end stops the accepting thread.
+    int m_wakeup[2] = { -1, -1 };
+    std::thread m_acceptor;
+    /// Guards the members below.
+    std::mutex m_mutex;
+    /// The open connections, and the closed ones whose threads are not joined yet.
+    std::list<Connection> m_connections;
+};
+
+/// A singleton that is a client proxy of an instance hosted in another process.
+/** Inherit from it with the CRTP style, and implement the interface of the singleton with
+  * virtual functions forwarding to `CallRemote()`:
+  *
+  * ```cpp
+  * class Index : public RemoteSingleton<Index>
+  * {
+  * public:
+  *     virtual std::string Lookup(const std::string& key)
+  *     {
+  *         return CallRemote(LOOKUP, key).get();
+  *     }
+  * protected:
+  *     Index() : RemoteSingleton("/run/index.sock") {}
+  *     friend BaseType;
+  * };
+  * ```
+  *
+  * The connection is only made by the first call, so tests can `Inject()` an in-process
+  * stand-in that subclasses the proxy and overrides its functions, without a running server.
+  * If the connection is lost (for example, because the server is restarted), the outstanding
+  * calls fail, and the next call connects again.
+  */
+template <typename T>
+struct RemoteSingleton : Singleton<T>
+{
+protected:
+    explicit RemoteSingleton(std::string socketPath)
+        : m_socketPath(std::move(socketPath))
+    {
+    }
+
+    /// Sends a request to the server, connecting to it on the first call or after a failure.
+    /** @throw std::system_error If the connection fails.
+      */
+    std::future<std::string> CallRemote(std::uint32_t method, const std::string& payload)
+    {
+        std::shared_ptr<RemoteChannel> channel;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            if (!m_channel || m_channel->IsBroken())
+                m_channel = std::make_shared<RemoteChannel>(m_socketPath);
+            channel = m_channel;
+        }
+        return channel->Call(method, payload);
+    }
+private:
+    const std::string m_socketPath;
+    /// Guards the member below.
+    std::mutex m_mutex;
+    /// The current connection. The calls in progress keep a replaced one alive.
+    std::shared_ptr<RemoteChannel> m_channel;
+};
+
+#endif
@@ -4,6 +4,25 @@
 #include <mutex>
 #include <utility>
 
+#include "singleton_phase.hpp"
+
+#if defined(__GXX_RTTI) || defined(_CPPRTTI) || defined(__cpp_rtti)
+#include <typeinfo>
+#define SINGLETON_HAS_RTTI 1
+#endif
+#if defined(SINGLETON_STATS) || defined(SINGLETON_TRACE)
+#include <atomic>
+#endif
+#ifdef SINGLETON_STATS
+#include "singleton_stats.hpp"
+#endif
+#ifdef SINGLETON_TRACE
+#include "singleton_trace.hpp"
+#endif
+#ifdef SINGLETON_REALMS
+#include "singleton_realm.hpp"
+#endif
+
 /// Implements the singleton pattern, but makes unit testing easy.
 /** To use the Singleton class normally, inherit from it with the CRTP style, like:
   *
@@ -19,6 +38,22 @@
   * possible to reconstruct the Singleton with different constructor arguments by using the
   * `MyClass::Reset()` function.
   * 
+  * If the `SINGLETON_STATS` macro is defined, the state of the singleton is published on the
+  * shared memory page described by `SingletonStats`. If the `SINGLETON_TRACE` macro is defined,
+  * the constructions of the singleton can be recorded with `SingletonTrace`.
+  *
+  * Constructions within `Get()` after `SingletonPhase::EnterServingPhase()` are reported.
+  *
+  * If the `SINGLETON_REALMS` macro is defined, `Get()` and `TryGet()` return the instance of the
+  * `SingletonRealm` bound to the calling thread, if any. `Inject()` and `Reset()` only affect the
+  * instance outside of realms, and the instances of realms are neither published on the
+  * statistics page nor recorded by the trace.
+  *
+  * The `SINGLETON_STATS`, `SINGLETON_TRACE` and `SINGLETON_REALMS` macros change the inline
+  * `Get()` function, so they must be defined for the whole program, for example with the CMake
+  * options of the same names. Defining them only in some translation units violates the one
+  * definition rule.
+  *
   * @remark The `Inject()` and `Reset()` functions are NOT thread safe! They should only be used
   *         in test code sections while implementation code is not running on a different thread.
   */
@@ -33,10 +68,12 @@ struct Singleton
     template <typename ...Args>
     static T& Get(Args... args)
     {
-        std::call_once(g_onceFlag, [](Args... args) {
-                g_instance.Emplace(std::forward<Args>(args)...);
-            }, args...);
-        return *static_cast<T*>(g_instance);
+        const void* callSite = SINGLETON_RETURN_ADDRESS();
+#ifdef SINGLETON_REALMS
+        if (SingletonRealm* realm = SingletonRealm::GetCurrent())
+            return GetInRealm(*realm, callSite, args...);
+#endif
+        return GetGlobal(callSite, args...);
     }
 
     ///  Returns the instance of the class without construction.
@@ -47,6 +84,10 @@ struct Singleton
       */
     static T* TryGet()
     {
+#ifdef SINGLETON_REALMS
+        if (SingletonRealm* realm = SingletonRealm::GetCurrent())
+            return static_cast<T*>(realm->TryGet(GetRealmSlot()));
+#endif
         return g_instance;
     }
 
@@ -129,6 +170,158 @@ private:
         union U { std::once_flag asOnceFlag; U(){} ~U(){} } buffer;
     } g_onceFlag;
 
+    /// Implements `Get()` for the instance outside of realms.
+    /** @param callSite The return address of the `Get()` call.
+      */
+    template <typename ...Args>
+    static T& GetGlobal(const void* callSite, Args... args)
+    {
+#if defined(SINGLETON_STATS) || defined(SINGLETON_TRACE)
+        if (!g_settled.load(std::memory_order_relaxed))
+            return GetMonitored(callSite, args...);
+#endif
+        std::call_once(g_onceFlag, [](const void* callSite, Args... args) {
+                CheckPhase(callSite);
+                g_instance.Emplace(std::forward<Args>(args)...);
+            }, callSite, args...);
+        return *static_cast<T*>(g_instance);
+    }
+
+    /// Reports the construction of the instance, if the program is in the serving phase.
+    /** @param callSite The return address of the `Get()` call that constructs the instance.
+      */
+    static void CheckPhase(const void* callSite)
+    {
+        if (SingletonPhase::IsServing())
+            SingletonPhase::ReportColdConstruction(TypeName(), callSite);
+    }
+
+    /// Returns the name of `T`, with static storage duration.
+    /** @return `typeid(T).name()`, or the signature of this function (naming `T`) without RTTI.
+      */
+    static const char* TypeName()
+    {
+#if defined(SINGLETON_HAS_RTTI)
+        return typeid(T).name();
+#elif defined(_MSC_VER)
+        return __FUNCSIG__;
+#else
+        return __PRETTY_FUNCTION__;
+#endif
+    }
+
+#if defined(SINGLETON_STATS) || defined(SINGLETON_TRACE)
+    /// Set when `Get()` cannot block anymore, so it does not need to be monitored.
+    static std::atomic<bool> g_settled;
+#ifdef SINGLETON_TRACE
+    /// The `SingletonTrace::Now()` time when the last construction ended.
+    static std::atomic<std::uint64_t> g_constructionEnd;
+#endif
+
+    /// Implements `Get()` while the instance may be unconstructed, monitoring the construction.
+    template <typename ...Args>
+    static T& GetMonitored(const void* callSite, Args... args)
+    {
+#ifdef SINGLETON_TRACE
+        const std::uint64_t waitBegin = SingletonTrace::Now();
+#endif
+#ifdef SINGLETON_STATS
+        SingletonStats::Entry& stats = GetStats();
+        // Every thread entering here is counted as a waiter, except the constructing one.
+        stats.waiters.fetch_add(1, std::memory_order_relaxed);
+#endif
+        bool constructed = false;
+        std::call_once(g_onceFlag, [&constructed](const void* callSite, Args... args) {
+                constructed = true;
+                EmplaceMonitored(callSite, std::forward<Args>(args)...);
+            }, callSite, args...);
+        if (!constructed)
+        {
+#ifdef SINGLETON_STATS
+            stats.waiters.fetch_sub(1, std::memory_order_relaxed);
+#endif
+#ifdef SINGLETON_TRACE
+            // The thread was only blocked if the construction was still running when it arrived.
+            if (SingletonTrace::IsRecording() &&
+                g_constructionEnd.load(std::memory_order_relaxed) > waitBegin)
+                SingletonTrace::Record(
+                    TypeName(), SingletonTrace::WAIT, waitBegin, SingletonTrace::Now());
+#endif
+        }
+        return *static_cast<T*>(g_instance);
+    }
+
+    /// Constructs the instance for `GetMonitored()`, recording the construction.
+    template <typename ...Args>
+    static void EmplaceMonitored(const void* callSite, Args... args)
+    {
+#ifdef SINGLETON_STATS
+        SingletonStats::Entry& stats = GetStats();
+        stats.waiters.fetch_sub(1, std::memory_order_relaxed);
+        const auto statsBegin = SingletonStats::BeginConstruction(stats);
+#endif
+#ifdef SINGLETON_TRACE
+        const std::uint64_t traceBegin = SingletonTrace::Now();
+#endif
+        CheckPhase(callSite);
+        try
+        {
+            g_instance.Emplace(std::forward<Args>(args)...);
+        }
+        catch (...)
+        {
+#ifdef SINGLETON_STATS
+            stats.state.store(SingletonStats::UNINITIALIZED, std::memory_order_relaxed);
+#endif
+            throw;
+        }
+#ifdef SINGLETON_TRACE
+        const std::uint64_t traceEnd = SingletonTrace::Now();
+        g_constructionEnd.store(traceEnd, std::memory_order_relaxed);
+        if (SingletonTrace::IsRecording())
+            SingletonTrace::Record(
+                TypeName(), SingletonTrace::CONSTRUCTION, traceBegin, traceEnd);
+#endif
+#ifdef SINGLETON_STATS
+        SingletonStats::EndConstruction(stats, statsBegin);
+#endif
+        g_settled.store(true, std::memory_order_relaxed);
+    }
+#endif
+
+#ifdef SINGLETON_REALMS
+    /// Returns the slot index of the singleton in the realms, assigning it on first use.
+    static std::size_t GetRealmSlot()
+    {
+        static const std::size_t slot = SingletonRealm::AllocateSlot();
+        return slot;
+    }
+
+    /// Implements `Get()` for the instance of a realm.
+    template <typename ...Args>
+    static T& GetInRealm(SingletonRealm& realm, const void* callSite, Args... args)
+    {
+        void* instance = realm.Get(GetRealmSlot(), sizeof(T), alignof(T),
+            [&](void* memory) {
+                CheckPhase(callSite);
+                new (memory) T(std::forward<Args>(args)...);
+            },
+            [](void* memory) {
+                static_cast<T*>(memory)->~T();
+            });
+        return *static_cast<T*>(instance);
+    }
+#endif
+
+#ifdef SINGLETON_STATS
+    /// Returns the statistics entry of the singleton, registering it on first use.
+    static SingletonStats::Entry& GetStats()
+    {
+        static SingletonStats::Entry& entry = SingletonStats::Register(TypeName(), sizeof(T));
+        return entry;
+    }
+#endif
+
     /// (Re)constructs the internal singleton instance.
     /** If an existing singleton instance was already constructed, it is destroyed. If an external
       * instance was injected, it is overridden with the newly constructed instance.
@@ -139,7 +332,14 @@ private:
     static T& Reset(Args... args)
     {
         g_onceFlag.Reset();
-        return Get(std::forward<Args>(args)...);
+#if defined(SINGLETON_STATS) || defined(SINGLETON_TRACE)
+        g_settled.store(false, std::memory_order_relaxed);
+#endif
+#ifdef SINGLETON_STATS
+        GetStats().state.store(SingletonStats::UNINITIALIZED, std::memory_order_relaxed);
+#endif
+        // The instance outside of realms is reconstructed, even within a `SingletonRealm::Scope`.
+        return GetGlobal(SINGLETON_RETURN_ADDRESS(), std::forward<Args>(args)...);
     }
 
     /// Injects an external instance into the singleton.
@@ -155,12 +355,28 @@ private:
         else
             g_onceFlag.Reset();
         g_instance.SetExtern(object);
+#if defined(SINGLETON_STATS) || defined(SINGLETON_TRACE)
+        g_settled.store(object != nullptr, std::memory_order_relaxed);
+#endif
+#ifdef SINGLETON_STATS
+        GetStats().state.store(
+            object ? SingletonStats::INJECTED : SingletonStats::UNINITIALIZED,
+            std::memory_order_relaxed);
+#endif
     }
 };
 template <typename T>
 typename Singleton<T>::Instance Singleton<T>::g_instance;
 template <typename T>
 typename Singleton<T>::OnceFlag Singleton<T>::g_onceFlag;
+#if defined(SINGLETON_STATS) || defined(SINGLETON_TRACE)
+template <typename T>
+std::atomic<bool> Singleton<T>::g_settled{ false };
+#endif
+#ifdef SINGLETON_TRACE
+template <typename T>
+std::atomic<std::uint64_t> Singleton<T>::g_constructionEnd{ 0 };
+#endif
 template <typename T>
 T* const Singleton<T>::Instance::LOCAL_INSTANCE_ID = reinterpret_cast<T*>(1);
 
@@ -0,0 +1,91 @@
+#ifndef TESTABLE_SINGLETON_FORK_GTEST_INCLUDED_H
+#define TESTABLE_SINGLETON_FORK_GTEST_INCLUDED_H
+
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <gtest/gtest.h>
+
+#include "singleton_fork_runner.hpp"
+
+/// Runs the Google Test tests with `SingletonForkRunner`, each test in its own forked child.
+/** Use it from a custom `main()` function, after constructing the expensive singletons:
+  *
+  * ```cpp
+  * int main(int argc, char** argv)
+  * {
+  *     ::testing::InitGoogleTest(&argc, argv);
+  *     ExpensiveSingleton::Get();
+  *     return RunAllTestsForked(4);
+  * }
+  * ```
+  *
+  * The `--gtest_filter` flag selects the tests as usual, and disabled tests are skipped unless
+  * `--gtest_also_run_disabled_tests` is given. `--gtest_list_tests` lists the tests without
+  * forking. The output of each test is printed as soon as its child process exits, and a
+  * summary of the failed tests is printed at the end.
+  *
+  * @remark The `--gtest_output` flag is not supported, because the children would overwrite
+  *         each other's report. The tests are not run if it is given.
+  * @param jobs The maximal number of tests running in parallel.
+  * @return The exit code of the test program: 0 if all tests passed, 1 otherwise.
+  */
+inline int RunAllTestsForked(unsigned jobs = 1)
+{
+    if (GTEST_FLAG_GET(list_tests))
+        return RUN_ALL_TESTS();
+    if (!GTEST_FLAG_GET(output).empty())
+    {
+        std::fprintf(stderr, "RunAllTestsForked() does not support the --gtest_output flag.\n");
+        return 1;
+    }
+
+    const ::testing::UnitTest& unitTest = *::testing::UnitTest::GetInstance();
+    const std::string filter = GTEST_FLAG_GET(filter);
+    const bool runDisabled = GTEST_FLAG_GET(also_run_disabled_tests);
+
+    std::vector<std::string> tests;
+    for (int i = 0; i < unitTest.total_test_suite_count(); ++i)
+    {
+        const ::testing::TestSuite& suite = *unitTest.GetTestSuite(i);
+        for (int j = 0; j < suite.total_test_count(); ++j)
+        {
+            const ::testing::TestInfo& info = *suite.GetTestInfo(j);
+            std::string name = std::string(info.test_suite_name()) + "." + info.name();
+            bool disabled = name.compare(0, 9, "DISABLED_") == 0 ||
+                name.find(".DISABLED_") != std::string::npos;
+            if ((runDisabled || !disabled) && SingletonForkRunner::MatchesFilter(name, filter))
+                tests.push_back(name);
+        }
+    }
+
+    auto results = SingletonForkRunner::Run(tests, [](const std::string& test) {
+            GTEST_FLAG_SET(filter, test);
+            return RUN_ALL_TESTS();
+        }, jobs, [](const SingletonForkRunner::Result& result) {
+            std::fputs(result.output.c_str(), stdout);
+            if (result.signal != 0)
+                std::printf("%s was killed by signal %d\n", result.test.c_str(), result.signal);
+            std::fflush(stdout);
+        });
+
+    std::vector<std::string> failed;
+    for (const auto& result : results)
+        if (!result.Passed())
+            failed.push_back(result.test);
+
+    std::printf("[==========] %u tests ran in forked processes.\n",
+        static_cast<unsigned>(results.size()));
+    if (failed.empty())
+    {
+        std::printf("[  PASSED  ] %u tests.\n", static_cast<unsigned>(results.size()));
+        return 0;
+    }
+    std::printf("[  FAILED  ] %u tests, listed below:\n", static_cast<unsigned>(failed.size()));
+    for (const auto& test : failed)
+        std::printf("[  FAILED  ] %s\n", test.c_str());
+    return 1;
+}
+
+#endif
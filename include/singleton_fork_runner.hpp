@@ -0,0 +1,239 @@
+#ifndef TESTABLE_SINGLETON_FORK_RUNNER_INCLUDED_H
+#define TESTABLE_SINGLETON_FORK_RUNNER_INCLUDED_H
+
+#include <cerrno>
+#include <cstdio>
+#include <functional>
+#include <string>
+#include <vector>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+/// Runs tests in forked children of a process that has already constructed its singletons.
+/** Tests that use real, expensive singletons would have to rebuild them with `Reset()` for every
+  * test to start from a pristine state. Instead, the test process can construct them once, and
+  * run every test in a copy-on-write child process of itself:
+  *
+  * ```cpp
+  * ExpensiveSingleton::Get();
+  * auto results = SingletonForkRunner::Run(testNames, [](const std::string& test) {
+  *     return RunTest(test);
+  * });
+  * ```
+  *
+  * Each child starts with the singletons of the parent, already constructed, and may `Inject()`
+  * or `Reset()` them freely without affecting the other tests. The output of the children is
+  * captured, so that the output of the parallel children is not interleaved. See the
+  * `singleton_fork_gtest.hpp` file for the Google Test integration.
+  *
+  * The runner only waits for its own children, so other child processes of the test program
+  * (such as a sidecar server started before running the tests) are left for the program to reap.
+  *
+  * @remark Only the forking thread exists in the children. Singletons that own threads (such as
+  *         an `ActorSingleton` or a `RemoteSingleton` with an open connection) or that hold
+  *         locks at the time of the fork must not be constructed before running the tests.
+  * @remark This header requires POSIX `fork()`.
+  */
+struct SingletonForkRunner
+{
+    /// The outcome of a test run in a child process.
+    struct Result
+    {
+        std::string test;
+        /// The exit code of the child, or -1 if it was killed by a signal.
+        int exitCode = -1;
+        /// The signal that killed the child, or 0 if it exited.
+        int signal = 0;
+        /// The captured standard output and error of the child.
+        std::string output;
+
+        bool Passed() const { return signal == 0 && exitCode == 0; }
+    };
+
+    /// Runs a single test in the child process, returning its exit code (0 means passed).
+    using TestFunction = std::function<int(const std::string& test)>;
+    /// Receives the result of a test in the parent process, as soon as its child has exited.
+    using ResultFunction = std::function<void(const Result& result)>;
+
+    /// Runs each test in its own forked child, at most `jobs` children at a time.
+    /** @param onResult If set, it is called with each result in the order of completion.
+      * @return The results in the order of `tests`.
+      */
+    static std::vector<Result> Run(const std::vector<std::string>& tests,
+        const TestFunction& runTest, unsigned jobs = 1, const ResultFunction& onResult = nullptr)
+    {
+        struct Child
+        {
+            pid_t pid;
+            std::size_t index;
+            std::FILE* output;
+            /// The read end of a pipe that is closed when the child exits.
+            int exited;
+        };
+        std::vector<Result> results(tests.size());
+        std::vector<Child> children;
+        std::size_t next = 0;
+        if (jobs == 0)
+            jobs = 1;
+
+        while (next < tests.size() || !children.empty())
+        {
+            while (next < tests.size() && children.size() < jobs)
+            {
+                results[next].test = tests[next];
+                Child child = { -1, next, std::tmpfile(), -1 };
+                int exited[2] = { -1, -1 };
+                // Unflushed output would be duplicated into the child.
+                std::fflush(nullptr);
+                if (child.output && pipe(exited) == 0)
+                    child.pid = fork();
+                if (child.pid == 0)
+                {
+                    close(exited[0]);
+                    // Programs executed by the test must not delay the detection of its exit.
+                    fcntl(exited[1], F_SETFD, FD_CLOEXEC);
+                    RunChild(tests[next], runTest, fileno(child.output));
+                }
+                if (exited[1] != -1)
+                    close(exited[1]);
+                child.exited = exited[0];
+                if (child.pid == -1)
+                {
+                    results[next].output = "Failed to fork the test process.\n";
+                    if (child.output)
+                        std::fclose(child.output);
+                    if (child.exited != -1)
+                        close(child.exited);
+                    if (onResult)
+                        onResult(results[next]);
+                }
+                else
+                {
+                    children.push_back(child);
+                }
+                ++next;
+            }
+            if (children.empty())
+                continue;
+
+            // Wait for any of the pipes to be closed by the exit of its child.
+            std::vector<pollfd> fds;
+            for (const auto& child : children)
+                fds.push_back({ child.exited, POLLIN, 0 });
+            if (poll(fds.data(), fds.size(), -1) == -1)
+            {
+                if (errno == EINTR)
+                    continue;
+                // Fall back to waiting for the oldest child.
+                fds[0].revents = POLLHUP;
+            }
+            std::size_t i = 0;
+            for (auto it = children.begin(); it != children.end(); ++i)
+            {
+                if (!fds[i].revents)
+                {
+                    ++it;
+                    continue;
+                }
+                Result& result = results[it->index];
+                int status = 0;
+                pid_t pid = waitpid(it->pid, &status, 0);
+                while (pid == -1 && errno == EINTR)
+                    pid = waitpid(it->pid, &status, 0);
+                if (pid == -1)
+                    result.output = "Failed to wait for the test process.\n";
+                else if (WIFEXITED(status))
+                    result.exitCode = WEXITSTATUS(status);
+                else if (WIFSIGNALED(status))
+                    result.signal = WTERMSIG(status);
+                ReadOutput(it->output, result.output);
+                close(it->exited);
+                it = children.erase(it);
+                if (onResult)
+                    onResult(result);
+            }
+        }
+        return results;
+    }
+
+    /// Returns whether a test name matches a Google Test style filter.
+    /** The filter is a `:`-separated list of wildcard patterns (using `*` and `?`), optionally
+      * followed by `-` and a list of negative patterns.
+      */
+    static bool MatchesFilter(const std::string& test, const std::string& filter)
+    {
+        const std::size_t dash = filter.find('-');
+        const std::string positive = filter.substr(0, dash);
+        return MatchesAny(test, positive.empty() ? "*" : positive) &&
+            (dash == std::string::npos || !MatchesAny(test, filter.substr(dash + 1)));
+    }
+private:
+    /// Runs a test in the child process. Never returns.
+    static void RunChild(const std::string& test, const TestFunction& runTest, int output)
+    {
+        int exitCode = 1;
+        if (dup2(output, STDOUT_FILENO) != -1 && dup2(output, STDERR_FILENO) != -1)
+        {
+            try
+            {
+                exitCode = runTest(test);
+            }
+            catch (...)
+            {
+                std::fprintf(stderr, "Unhandled exception in test %s\n", test.c_str());
+            }
+        }
+        std::fflush(nullptr);
+        // Skip the static destructors, which would release the resources shared with the parent.
+        _exit(exitCode);
+    }
+
+    /// Reads and closes the captured output file of a child.
+    static void ReadOutput(std::FILE* file, std::string& output)
+    {
+        std::rewind(file);
+        char buffer[4096];
+        std::size_t size;
+        while ((size = std::fread(buffer, 1, sizeof(buffer), file)) > 0)
+            output.append(buffer, size);
+        std::fclose(file);
+    }
+
+    /// Returns whether `test` matches any of the `:`-separated patterns.
+    static bool MatchesAny(const std::string& test, const std::string& patterns)
+    {
+        std::size_t begin = 0;
+        for (;;)
+        {
+            std::size_t end = patterns.find(':', begin);
+            if (MatchesPattern(test.c_str(), patterns.substr(begin, end - begin).c_str()))
+                return true;
+            if (end == std::string::npos)
+                return false;
+            begin = end + 1;
+        }
+    }
+
+    /// Returns whether `text` matches the wildcard `pattern`.
+    static bool MatchesPattern(const char* text, const char* pattern)
+    {
+        switch (*pattern)
+        {
+        case '\0':
+            return *text == '\0';
+        case '*':
+            return MatchesPattern(text, pattern + 1) ||
+                (*text != '\0' && MatchesPattern(text + 1, pattern));
+        case '?':
+            return *text != '\0' && MatchesPattern(text + 1, pattern + 1);
+        default:
+            return *text == *pattern && MatchesPattern(text + 1, pattern + 1);
+        }
+    }
+};
+
+#endif
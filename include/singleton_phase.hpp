@@ -0,0 +1,131 @@
+#ifndef TESTABLE_SINGLETON_PHASE_INCLUDED_H
+#define TESTABLE_SINGLETON_PHASE_INCLUDED_H
+
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(_MSC_VER)
+#include <intrin.h>
+#pragma intrinsic(_ReturnAddress)
+/// The address that the current function returns to, or `nullptr` if unsupported.
+#define SINGLETON_RETURN_ADDRESS() _ReturnAddress()
+#elif defined(__GNUC__)
+#define SINGLETON_RETURN_ADDRESS() __builtin_return_address(0)
+#else
+#define SINGLETON_RETURN_ADDRESS() nullptr
+#endif
+
+/// Tracks the life cycle phase of the program, to catch singletons constructed while serving.
+/** After warming up, a program should have constructed all of its singletons. A singleton that
+  * is constructed lazily within `Get()` after this point is a latency spike on the serving path.
+  * Call `SingletonPhase::EnterServingPhase()` when the warmup is complete, and any further
+  * construction in `Singleton<T>::Get()` is reported according to the given policy:
+  *
+  * ```cpp
+  * int main()
+  * {
+  *     PrewarmSingletons();
+  *     // Abort in canaries, log elsewhere.
+  *     SingletonPhase::EnterServingPhase(isCanary ? SingletonPhase::FATAL : SingletonPhase::LOG);
+  *     Serve();
+  * }
+  * ```
+  *
+  * Checking the phase only happens when an instance is constructed, so it does not affect the
+  * performance of `Get()` otherwise. The default handler prints the constructed type and the call
+  * site to `stderr`. To print the full call stack instead, install the handler of the
+  * `singleton_phase_backtrace.hpp` file.
+  */
+struct SingletonPhase
+{
+    /// Determines how a construction in the serving phase is reported.
+    enum Policy
+    {
+        /// Only count the construction.
+        COUNT,
+        /// Count the construction and call the handler (which logs the call site by default).
+        LOG,
+        /// Count the construction, call the handler, then abort the program.
+        FATAL,
+    };
+
+    /// A function that reports a construction in the serving phase.
+    /** @param typeName The name of the constructed type, as returned by `typeid(T).name()`. If
+      *                 RTTI is disabled, the signature of a `Singleton<T>` function naming `T`.
+      * @param callSite The return address of the `Get()` call that constructed the instance (or
+      *                 of the function that `Get()` is inlined into). It is `nullptr` on compilers
+      *                 that cannot provide it.
+      */
+    using Handler = void (*)(const char* typeName, const void* callSite);
+
+    /// Enters the serving phase, after which the singleton constructions are reported.
+    static void EnterServingPhase(Policy policy = LOG)
+    {
+        GetState().policy.store(policy, std::memory_order_relaxed);
+        GetState().serving.store(true, std::memory_order_release);
+    }
+
+    /// Leaves the serving phase (for example, to reconfigure the program).
+    static void LeaveServingPhase()
+    {
+        GetState().serving.store(false, std::memory_order_release);
+    }
+
+    /// Returns whether the program is in the serving phase.
+    static bool IsServing()
+    {
+        return GetState().serving.load(std::memory_order_acquire);
+    }
+
+    /// Returns the number of singletons constructed in the serving phase so far.
+    static std::uint64_t GetColdConstructions()
+    {
+        return GetState().coldConstructions.load(std::memory_order_relaxed);
+    }
+
+    /// Replaces the handler that reports the constructions with the `LOG` and `FATAL` policies.
+    /** @param handler The new handler, or `nullptr` to restore the default handler.
+      */
+    static void SetHandler(Handler handler)
+    {
+        GetState().handler.store(handler ? handler : &Log, std::memory_order_release);
+    }
+
+    /// Reports a singleton constructed in the serving phase. Called by `Singleton<T>`.
+    static void ReportColdConstruction(const char* typeName, const void* callSite)
+    {
+        State& state = GetState();
+        state.coldConstructions.fetch_add(1, std::memory_order_relaxed);
+        Policy policy = state.policy.load(std::memory_order_relaxed);
+        if (policy == COUNT)
+            return;
+        state.handler.load(std::memory_order_acquire)(typeName, callSite);
+        if (policy == FATAL)
+            std::abort();
+    }
+private:
+    struct State
+    {
+        std::atomic<bool> serving{ false };
+        std::atomic<Policy> policy{ LOG };
+        std::atomic<Handler> handler{ &Log };
+        std::atomic<std::uint64_t> coldConstructions{ 0 };
+    };
+
+    static State& GetState()
+    {
+        static State state;
+        return state;
+    }
+
+    /// The default handler, which prints the singleton and its call site to `stderr`.
+    static void Log(const char* typeName, const void* callSite)
+    {
+        std::fprintf(stderr, "Singleton constructed in the serving phase: %s, called from %p\n",
+            typeName, callSite);
+    }
+};
+
+#endif
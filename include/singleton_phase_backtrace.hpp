@@ -0,0 +1,33 @@
+#ifndef TESTABLE_SINGLETON_PHASE_BACKTRACE_INCLUDED_H
+#define TESTABLE_SINGLETON_PHASE_BACKTRACE_INCLUDED_H
+
+#include <cstdio>
+
+#include <execinfo.h>
+
+#include "singleton_phase.hpp"
+
+/// A `SingletonPhase` handler that prints the full call stack of the cold constructions.
+/** Install it when entering the serving phase:
+  *
+  * ```cpp
+  * SingletonPhase::SetHandler(&SingletonPhaseBacktrace::Log);
+  * SingletonPhase::EnterServingPhase(SingletonPhase::LOG);
+  * ```
+  *
+  * @remark This header requires `<execinfo.h>` (glibc, macOS, or the BSDs with `-lexecinfo`).
+  */
+struct SingletonPhaseBacktrace
+{
+    /// Prints the singleton, its call site and the call stack to `stderr`.
+    static void Log(const char* typeName, const void* callSite)
+    {
+        std::fprintf(stderr, "Singleton constructed in the serving phase: %s, called from %p\n",
+            typeName, callSite);
+        void* frames[32];
+        int count = backtrace(frames, 32);
+        backtrace_symbols_fd(frames, count, 2);
+    }
+};
+
+#endif
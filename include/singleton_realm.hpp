@@ -0,0 +1,254 @@
+#ifndef TESTABLE_SINGLETON_REALM_INCLUDED_H
+#define TESTABLE_SINGLETON_REALM_INCLUDED_H
+
+#include <algorithm>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <mutex>
+#include <new>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define SINGLETON_REALM_NUMA 1
+#endif
+
+#ifndef SINGLETON_REALM_CAPACITY
+/// The maximal number of singleton types that can be used in realms.
+#define SINGLETON_REALM_CAPACITY 1024
+#endif
+
+/// An independent set of singleton instances within the process.
+/** Realms are only supported if the `SINGLETON_REALMS` macro is defined for the whole program
+  * (see `Singleton<T>`). While a realm is bound to a thread with a `SingletonRealm::Scope`,
+  * `Singleton<T>::Get()` on that thread returns the instance of the realm, which is constructed on
+  * first use. This allows running multiple, isolated shards of a service within one process:
+  *
+  * ```cpp
+  * SingletonRealm realm(numaNode);
+  * std::thread worker([&realm]() {
+  *     SingletonRealm::Scope scope(realm);
+  *     MySingleton::Get(); // The instance of `realm`.
+  * });
+  * ```
+  *
+  * Each singleton type is assigned a slot index on first use, so resolving an instance in a
+  * realm takes constant time. The instances are destroyed in the reverse order of their
+  * construction when the realm is destroyed. `Inject()` and `Reset()` only affect the instances
+  * outside of realms.
+  *
+  * @remark Within a realm, `Get()` bypasses the statistics of `SINGLETON_STATS`, the recording
+  *         of `SINGLETON_TRACE`, and the injected instance. The serving phase is still checked.
+  *
+  * On Linux, the instances (and the slot table) of a realm created for a NUMA node are allocated
+  * in memory that prefers the given node. If the system has no NUMA support, or the node does not
+  * exist, the node is ignored, which `IsNumaBound()` reports.
+  */
+class SingletonRealm final
+{
+public:
+    /// Binds a realm to the current thread while the scope exists.
+    class Scope final
+    {
+    public:
+        explicit Scope(SingletonRealm& realm)
+            : m_previous(GetCurrentRef())
+        {
+            GetCurrentRef() = &realm;
+        }
+        Scope(const Scope&) = delete;
+        ~Scope()
+        {
+            GetCurrentRef() = m_previous;
+        }
+        Scope& operator =(const Scope&) = delete;
+    private:
+        SingletonRealm* const m_previous;
+    };
+
+    /// Creates a realm.
+    /** @param numaNode The NUMA node to allocate the instances on, or -1 for no preference.
+      */
+    explicit SingletonRealm(int numaNode = -1)
+        : m_numaNode(numaNode), m_numaBound(numaNode >= 0)
+    {
+        void* slots = Allocate(sizeof(Slot) * SINGLETON_REALM_CAPACITY, alignof(Slot));
+        m_slots = new (slots) Slot[SINGLETON_REALM_CAPACITY];
+    }
+    SingletonRealm(const SingletonRealm&) = delete;
+    /// Destroys the instances of the realm, in the reverse order of their construction.
+    /** @remark The realm must not be bound to any thread at this point.
+      */
+    ~SingletonRealm()
+    {
+        for (auto it = m_instances.rbegin(); it != m_instances.rend(); ++it)
+            it->second(it->first);
+        for (std::size_t i = 0; i < SINGLETON_REALM_CAPACITY; ++i)
+            m_slots[i].~Slot();
+        for (const auto& chunk : m_chunks)
+            Free(chunk.first, chunk.second);
+    }
+    SingletonRealm& operator =(const SingletonRealm&) = delete;
+
+    /// Returns the realm bound to the current thread, or `nullptr` if none is bound.
+    static SingletonRealm* GetCurrent()
+    {
+        return GetCurrentRef();
+    }
+
+    /// Returns the NUMA node of the realm, or -1 if it has no preference.
+    int GetNumaNode() const
+    {
+        return m_numaNode;
+    }
+
+    /// Returns whether all memory of the realm prefers its NUMA node.
+    /** @return `false` if the realm has no preference, or the preference could not be applied to
+      *         some of its memory (for example, because the system or the node is not available).
+      */
+    bool IsNumaBound() const
+    {
+        return m_numaBound.load(std::memory_order_relaxed);
+    }
+
+    /// Assigns a slot index to a singleton type. Called once per type by `Singleton<T>`.
+    /** @throw std::length_error If more than `SINGLETON_REALM_CAPACITY` types use realms.
+      */
+    static std::size_t AllocateSlot()
+    {
+        static std::atomic<std::size_t> nextSlot{ 0 };
+        std::size_t slot = nextSlot.fetch_add(1, std::memory_order_relaxed);
+        if (slot >= SINGLETON_REALM_CAPACITY)
+            throw std::length_error("SingletonRealm: SINGLETON_REALM_CAPACITY is exceeded");
+        return slot;
+    }
+
+    /// Returns the instance in `slot`, or `nullptr` if it is unconstructed.
+    void* TryGet(std::size_t slot) const
+    {
+        return m_slots[slot].instance.load(std::memory_order_acquire);
+    }
+
+    /// Returns the instance in `slot`, constructing it first if needed.
+    /** @param construct Constructs the instance in the memory passed to it.
+      * @param destroy Destroys the instance, when the realm is destroyed.
+      */
+    template <typename Construct>
+    void* Get(std::size_t slot, std::size_t size, std::size_t alignment, Construct construct,
+        void (*destroy)(void*))
+    {
+        Slot& entry = m_slots[slot];
+        if (void* instance = entry.instance.load(std::memory_order_acquire))
+            return instance;
+        std::call_once(entry.once, [&]() {
+                void* memory = Allocate(size, alignment);
+                construct(memory);
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    m_instances.emplace_back(memory, destroy);
+                }
+                entry.instance.store(memory, std::memory_order_release);
+            });
+        return entry.instance.load(std::memory_order_acquire);
+    }
+private:
+    /// Holds the instance of a singleton type in the realm.
+    struct Slot
+    {
+        std::atomic<void*> instance{ nullptr };
+        std::once_flag once;
+    };
+
+    /// The size of the memory chunks that the instances are allocated from.
+    enum : std::size_t { CHUNK_SIZE = 1024 * 1024 };
+
+    static SingletonRealm*& GetCurrentRef()
+    {
+        static thread_local SingletonRealm* current = nullptr;
+        return current;
+    }
+
+    /// Allocates memory from the chunks of the realm. It is freed with the realm.
+    /** @param alignment A power of two. The chunks themselves may be less aligned than this.
+      */
+    void* Allocate(std::size_t size, std::size_t alignment)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        std::size_t offset = 0;
+        if (!m_chunks.empty())
+            offset = AlignOffset(m_chunks.back().first, m_chunkUsed, alignment);
+        if (m_chunks.empty() || offset + size > m_chunks.back().second)
+        {
+            // The chunk has room for aligning the instance, whatever its own alignment is.
+            std::size_t chunkSize = std::max<std::size_t>(CHUNK_SIZE, size + alignment);
+            m_chunks.emplace_back(AllocateChunk(chunkSize), chunkSize);
+            offset = AlignOffset(m_chunks.back().first, 0, alignment);
+        }
+        m_chunkUsed = offset + size;
+        return static_cast<char*>(m_chunks.back().first) + offset;
+    }
+
+    /// Returns the first offset from `offset` in `chunk` that is an `alignment` aligned address.
+    static std::size_t AlignOffset(void* chunk, std::size_t offset, std::size_t alignment)
+    {
+        const std::uintptr_t address = reinterpret_cast<std::uintptr_t>(chunk) + offset;
+        const std::uintptr_t aligned = (address + alignment - 1) & ~(alignment - 1);
+        return offset + static_cast<std::size_t>(aligned - address);
+    }
+
+    /// Allocates a chunk of memory, preferring the NUMA node of the realm.
+    void* AllocateChunk(std::size_t size)
+    {
+#ifdef SINGLETON_REALM_NUMA
+        void* chunk = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (chunk == MAP_FAILED)
+            throw std::bad_alloc();
+        if (m_numaNode >= 0)
+        {
+            // The policy applies to the pages when they are first touched by the constructors.
+            const unsigned long MPOL_PREFERRED_MODE = 1;
+            const std::size_t BITS = sizeof(unsigned long) * 8;
+            std::vector<unsigned long> nodeMask(m_numaNode / BITS + 1);
+            nodeMask[m_numaNode / BITS] = 1ul << (m_numaNode % BITS);
+            if (syscall(SYS_mbind, chunk, size, MPOL_PREFERRED_MODE, nodeMask.data(),
+                nodeMask.size() * BITS + 1, 0) != 0)
+                m_numaBound.store(false, std::memory_order_relaxed);
+        }
+        return chunk;
+#else
+        m_numaBound.store(false, std::memory_order_relaxed);
+        return ::operator new(size);
+#endif
+    }
+
+    static void Free(void* chunk, std::size_t size)
+    {
+#ifdef SINGLETON_REALM_NUMA
+        munmap(chunk, size);
+#else
+        (void)size;
+        ::operator delete(chunk);
+#endif
+    }
+
+    const int m_numaNode;
+    /// Cleared when the NUMA preference of a chunk could not be applied.
+    std::atomic<bool> m_numaBound;
+    /// The table of instances, indexed by the slots of the singleton types.
+    Slot* m_slots = nullptr;
+    /// Guards the members below.
+    std::mutex m_mutex;
+    /// The allocated chunks and their sizes.
+    std::vector<std::pair<void*, std::size_t>> m_chunks;
+    /// The used size of the last chunk.
+    std::size_t m_chunkUsed = 0;
+    /// The constructed instances and their destroy functions, in the order of construction.
+    std::vector<std::pair<void*, void (*)(void*)>> m_instances;
+};
+
+#endif
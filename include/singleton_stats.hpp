@@ -0,0 +1,219 @@
+#ifndef TESTABLE_SINGLETON_STATS_INCLUDED_H
+#define TESTABLE_SINGLETON_STATS_INCLUDED_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+
+#if defined(__unix__) || defined(__APPLE__)
+#include <fcntl.h>
+#include <pthread.h>
+#include <sys/mman.h>
+#include <unistd.h>
+#define SINGLETON_STATS_SHARED_MEMORY 1
+#endif
+
+/// Maintains a shared memory page that lists the state of every `Singleton<T>` in the process.
+/** The page is only maintained if the `SINGLETON_STATS` macro is defined for the whole program
+  * (see `Singleton<T>`). It is created on POSIX systems as the `/singleton_stats.<pid>` shared
+  * memory object when the first singleton is registered, and unlinked at exit. The
+  * `singleton_stats` tool in this repository prints it.
+  *
+  * Singletons register themselves when `Get()` first takes its slow path, or when `Inject()` is
+  * called. The entries are updated with lock-free atomic operations only, so that readers in other
+  * processes never block the inspected process.
+  *
+  * A child process created with `fork()` continues with a private copy of the page, so that its
+  * singletons (for example, the ones injected or reset by the tests of `SingletonForkRunner`) do
+  * not overwrite the state published by the parent. The states in the child are not published.
+  *
+  * @remark On systems without POSIX shared memory, the page is kept in process-local memory.
+  */
+struct SingletonStats
+{
+    /// The life cycle state of a singleton.
+    enum State : std::uint32_t
+    {
+        UNINITIALIZED,
+        CONSTRUCTING,
+        LOCAL,
+        INJECTED,
+    };
+
+    enum : std::uint32_t
+    {
+        /// Identifies the layout of the page for readers.
+        MAGIC = 0x53475453, // "STGS"
+        VERSION = 1,
+        /// The maximal number of singletons listed on the page.
+        CAPACITY = 256,
+        /// The maximal length of a type name, including the terminating zero.
+        NAME_SIZE = 128,
+    };
+
+    /// The statistics of a single singleton type.
+    struct Entry
+    {
+        /// Non-zero after `typeName` and `size` are written.
+        std::atomic<std::uint32_t> published;
+        /// One of the `State` values.
+        std::atomic<std::uint32_t> state;
+        /// The number of threads blocked in `Get()` while the instance is constructed.
+        std::atomic<std::uint32_t> waiters;
+        std::uint32_t reserved;
+        /// The size of the instance in bytes.
+        std::uint64_t size;
+        /// The time of the last completed construction, in nanoseconds since the Unix epoch.
+        std::atomic<std::uint64_t> constructedAt;
+        /// The duration of the last completed construction, in nanoseconds.
+        std::atomic<std::uint64_t> constructionTime;
+        /// The mangled name of the type (as returned by `typeid(T).name()`), maybe truncated.
+        char typeName[NAME_SIZE];
+    };
+
+    /// The layout of the shared memory page.
+    struct Page
+    {
+        std::uint32_t magic;
+        std::uint32_t version;
+        std::uint32_t capacity;
+        /// The number of allocated entries; may exceed `capacity` if singletons were dropped.
+        std::atomic<std::uint32_t> count;
+        Entry entries[CAPACITY];
+    };
+
+    /// Writes the shared memory object name of the page of process `pid` into `buffer`.
+    static void GetPageName(long pid, char (&buffer)[64])
+    {
+        std::snprintf(buffer, sizeof(buffer), "/singleton_stats.%ld", pid);
+    }
+
+    /// Returns the page of the current process, which is created on first use.
+    static Page& GetPage()
+    {
+        static Region region;
+        return *region.page;
+    }
+
+    /// Adds an entry for a singleton type to the page.
+    /** @return The entry of the type. If the page is full, an entry that is not on the page.
+      */
+    static Entry& Register(const char* typeName, std::size_t size)
+    {
+        Page& page = GetPage();
+        std::uint32_t index = page.count.fetch_add(1, std::memory_order_relaxed);
+        if (index >= CAPACITY)
+        {
+            // Overflowing singletons are still tracked, but invisible to readers.
+            Entry* entry = new Entry();
+            entry->size = size;
+            return *entry;
+        }
+        Entry& entry = page.entries[index];
+        std::strncpy(entry.typeName, typeName, NAME_SIZE - 1);
+        entry.size = size;
+        entry.published.store(1, std::memory_order_release);
+        return entry;
+    }
+
+    /// Returns the current time to be passed to `EndConstruction()`.
+    static std::chrono::steady_clock::time_point BeginConstruction(Entry& entry)
+    {
+        entry.state.store(CONSTRUCTING, std::memory_order_relaxed);
+        return std::chrono::steady_clock::now();
+    }
+
+    /// Records the completed construction that started at `begin`.
+    static void EndConstruction(Entry& entry, std::chrono::steady_clock::time_point begin)
+    {
+        using namespace std::chrono;
+        entry.constructionTime.store(
+            duration_cast<nanoseconds>(steady_clock::now() - begin).count(),
+            std::memory_order_relaxed);
+        entry.constructedAt.store(
+            duration_cast<nanoseconds>(system_clock::now().time_since_epoch()).count(),
+            std::memory_order_relaxed);
+        entry.state.store(LOCAL, std::memory_order_release);
+    }
+private:
+    /// Owns the memory of the page.
+    struct Region final
+    {
+        Region()
+        {
+#ifdef SINGLETON_STATS_SHARED_MEMORY
+            GetPageName(static_cast<long>(getpid()), name);
+            int fd = shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0644);
+            if (fd != -1)
+            {
+                void* addr = MAP_FAILED;
+                if (ftruncate(fd, sizeof(Page)) == 0)
+                    addr = mmap(nullptr, sizeof(Page), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+                close(fd);
+                if (addr != MAP_FAILED)
+                    page = static_cast<Page*>(addr);
+                else
+                    shm_unlink(name);
+            }
+            if (!page)
+                name[0] = '\0';
+            else
+                pthread_atfork(nullptr, nullptr, &Region::DetachInChild);
+            GetCurrent() = this;
+#endif
+            if (!page)
+                page = new Page();
+            page->capacity = CAPACITY;
+            page->version = VERSION;
+            page->magic = MAGIC;
+        }
+        Region(const Region&) = delete;
+        ~Region()
+        {
+            // The page stays mapped, because singletons may still be destroyed after this.
+#ifdef SINGLETON_STATS_SHARED_MEMORY
+            if (name[0])
+                shm_unlink(name);
+#endif
+        }
+        Region& operator =(const Region&) = delete;
+
+#ifdef SINGLETON_STATS_SHARED_MEMORY
+        /// Returns the region of the process, which is set once it is constructed.
+        /** It is a plain pointer, so that the fork handler does not wait for a static guard.
+          */
+        static Region*& GetCurrent()
+        {
+            static Region* current = nullptr;
+            return current;
+        }
+
+        /// Replaces the shared page with a private copy at the same address in a forked child.
+        static void DetachInChild()
+        {
+            Region* region = GetCurrent();
+            if (!region || !region->name[0])
+                return;
+            // The page of the parent must neither be written nor unlinked by the child.
+            region->name[0] = '\0';
+            void* copy = mmap(nullptr, sizeof(Page), PROT_READ | PROT_WRITE,
+                MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (copy == MAP_FAILED)
+                return;
+            std::memcpy(copy, static_cast<void*>(region->page), sizeof(Page));
+            if (mmap(region->page, sizeof(Page), PROT_READ | PROT_WRITE,
+                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_FIXED, -1, 0) != MAP_FAILED)
+                std::memcpy(static_cast<void*>(region->page), copy, sizeof(Page));
+            munmap(copy, sizeof(Page));
+        }
+#endif
+
+        Page* page = nullptr;
+        char name[64] = {};
+    };
+};
+
+#endif
@@ -0,0 +1,205 @@
+#ifndef TESTABLE_SINGLETON_TRACE_INCLUDED_H
+#define TESTABLE_SINGLETON_TRACE_INCLUDED_H
+
+#include <atomic>
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+/// Records the construction of singletons as a timeline in the Chrome trace event format.
+/** The recorder is only available if the `SINGLETON_TRACE` macro is defined for the whole program
+  * (see `Singleton<T>`). While recording, every `Singleton<T>` construction is recorded as an
+  * interval on the timeline of the constructing thread, including the constructions that are
+  * nested in other constructors. The intervals while other threads are blocked in `Get()`,
+  * waiting for the construction, are recorded on the timelines of the waiting threads.
+  *
+  * ```cpp
+  * int main()
+  * {
+  *     SingletonTrace::Start();
+  *     // Initialize the program...
+  *     SingletonTrace::Stop();
+  *     SingletonTrace::Write("startup.json");
+  * }
+  * ```
+  *
+  * The written file can be opened with `chrome://tracing` or <https://ui.perfetto.dev>.
+  *
+  * The events are recorded into per-thread buffers without locking. The buffers are never freed,
+  * so that the events of the exited threads are also written.
+  */
+struct SingletonTrace
+{
+    /// The kind of a recorded interval.
+    enum Kind : std::uint32_t
+    {
+        CONSTRUCTION,
+        WAIT,
+    };
+
+    /// Starts recording the events.
+    static void Start()
+    {
+        GetEpoch();
+        GetRecording().store(true, std::memory_order_release);
+    }
+
+    /// Stops recording the events. The already recorded events are kept.
+    static void Stop()
+    {
+        GetRecording().store(false, std::memory_order_release);
+    }
+
+    /// Returns whether the events are being recorded.
+    static bool IsRecording()
+    {
+        return GetRecording().load(std::memory_order_relaxed);
+    }
+
+    /// Returns the current time in nanoseconds, for the `Record()` function.
+    static std::uint64_t Now()
+    {
+        using namespace std::chrono;
+        return duration_cast<nanoseconds>(steady_clock::now() - GetEpoch()).count();
+    }
+
+    /// Records an interval on the timeline of the calling thread.
+    /** @param typeName The mangled name of the singleton type (or, without RTTI, a function
+      *                 signature naming it), with static storage duration.
+      */
+    static void Record(const char* typeName, Kind kind, std::uint64_t begin, std::uint64_t end)
+    {
+        Buffer* buffer = GetLocalBuffer();
+        std::size_t count = buffer->count.load(std::memory_order_relaxed);
+        if (count == Buffer::CAPACITY)
+        {
+            buffer = GetLocalBuffer() = new Buffer(buffer->threadId);
+            Publish(buffer);
+            count = 0;
+        }
+        buffer->events[count] = Event{ typeName, kind, begin, end };
+        buffer->count.store(count + 1, std::memory_order_release);
+    }
+
+    /// Writes the recorded events into a Chrome trace event format JSON file.
+    /** @return Whether the file was written successfully.
+      */
+    static bool Write(const char* path)
+    {
+        std::FILE* file = std::fopen(path, "w");
+        if (!file)
+            return false;
+        std::fputs("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[", file);
+        bool first = true;
+        for (Buffer* buffer = GetBuffers().load(std::memory_order_acquire); buffer;
+            buffer = buffer->next)
+        {
+            std::size_t count = buffer->count.load(std::memory_order_acquire);
+            for (std::size_t i = 0; i < count; ++i)
+            {
+                WriteEvent(file, buffer->threadId, buffer->events[i], first);
+                first = false;
+            }
+        }
+        std::fputs("\n]}\n", file);
+        return std::fclose(file) == 0;
+    }
+private:
+    /// A recorded interval.
+    struct Event
+    {
+        const char* typeName;
+        Kind kind;
+        std::uint64_t begin;
+        std::uint64_t end;
+    };
+
+    /// The events of a single thread. Only the owning thread writes it.
+    struct Buffer
+    {
+        static constexpr std::size_t CAPACITY = 1024;
+
+        explicit Buffer(std::uint32_t id) : threadId(id) {}
+
+        Buffer* next = nullptr;
+        const std::uint32_t threadId;
+        std::atomic<std::size_t> count{ 0 };
+        Event events[CAPACITY];
+    };
+
+    static std::atomic<bool>& GetRecording()
+    {
+        static std::atomic<bool> recording{ false };
+        return recording;
+    }
+
+    /// Returns the time point that the recorded times are relative to.
+    static std::chrono::steady_clock::time_point GetEpoch()
+    {
+        static const std::chrono::steady_clock::time_point epoch = std::chrono::steady_clock::now();
+        return epoch;
+    }
+
+    /// Returns the list of all buffers.
+    static std::atomic<Buffer*>& GetBuffers()
+    {
+        static std::atomic<Buffer*> buffers{ nullptr };
+        return buffers;
+    }
+
+    /// Returns the current buffer of the calling thread, allocating it on first use.
+    static Buffer*& GetLocalBuffer()
+    {
+        static std::atomic<std::uint32_t> nextThreadId{ 1 };
+        static thread_local Buffer* buffer = nullptr;
+        if (!buffer)
+        {
+            buffer = new Buffer(nextThreadId.fetch_add(1, std::memory_order_relaxed));
+            Publish(buffer);
+        }
+        return buffer;
+    }
+
+    /// Adds a buffer to the list of all buffers.
+    static void Publish(Buffer* buffer)
+    {
+        std::atomic<Buffer*>& buffers = GetBuffers();
+        buffer->next = buffers.load(std::memory_order_relaxed);
+        while (!buffers.compare_exchange_weak(
+            buffer->next, buffer, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+    }
+
+    /// Writes a complete ("X") trace event.
+    static void WriteEvent(std::FILE* file, std::uint32_t threadId, const Event& event, bool first)
+    {
+        char* demangled = nullptr;
+#if defined(__GNUG__)
+        int status = 0;
+        demangled = abi::__cxa_demangle(event.typeName, nullptr, nullptr, &status);
+#endif
+        std::fputs(first ? "\n{\"name\":\"" : ",\n{\"name\":\"", file);
+        if (event.kind == WAIT)
+            std::fputs("wait: ", file);
+        for (const char* c = demangled ? demangled : event.typeName; *c; ++c)
+        {
+            if (*c == '"' || *c == '\\')
+                std::fputc('\\', file);
+            std::fputc(*c, file);
+        }
+        std::free(demangled);
+        std::fprintf(file,
+            "\",\"cat\":\"%s\",\"ph\":\"X\",\"ts\":%.3f,\"dur\":%.3f,\"pid\":1,\"tid\":%u}",
+            event.kind == WAIT ? "wait" : "construction",
+            event.begin / 1e3, (event.end - event.begin) / 1e3, threadId);
+    }
+};
+
+#endif
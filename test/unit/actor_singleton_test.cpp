@@ -0,0 +1,142 @@
+#include <access_private.hpp>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+#include "../../include/actor_singleton.hpp"
+
+using namespace ::testing;
+
+/////////////
+// Test Cases
+
+// Scenario: Operations are executed on a single owner thread, which is not the caller's thread.
+
+template <int testCaseNum>
+struct CounterActor : ActorSingleton<CounterActor<testCaseNum>>
+{
+	int m_value = 0;
+	std::thread::id m_constructorThread = std::this_thread::get_id();
+protected:
+	CounterActor() = default;
+	friend typename CounterActor::BaseType;
+};
+
+TEST(ActorSingletonTest, RunsOnOwnerThread)
+{
+	using Actor = CounterActor<1>;
+
+	auto threadIds = Actor::Call([](Actor& self) {
+			return std::make_pair(std::this_thread::get_id(), self.m_constructorThread);
+		}).get();
+
+	EXPECT_NE(threadIds.first, std::this_thread::get_id());
+	EXPECT_EQ(threadIds.first, threadIds.second);
+}
+
+// Scenario: Posted operations are executed in order, before a later call.
+
+TEST(ActorSingletonTest, PostedOperationsAreOrdered)
+{
+	using Actor = CounterActor<2>;
+
+	for (int i = 1; i <= 1000; ++i)
+		Actor::Post([i](Actor& self) {
+				if (self.m_value + 1 == i)
+					self.m_value = i;
+			});
+
+	EXPECT_EQ(Actor::Call([](Actor& self) { return self.m_value; }).get(), 1000);
+}
+
+// Scenario: Operations posted concurrently from multiple threads are all executed.
+
+TEST(ActorSingletonTest, MultipleProducers)
+{
+	using Actor = CounterActor<3>;
+	const int THREADS = 8, POSTS = 10000;
+
+	std::vector<std::thread> producers;
+	for (int t = 0; t < THREADS; ++t)
+		producers.emplace_back([]() {
+				for (int i = 0; i < POSTS; ++i)
+					Actor::Post([](Actor& self) { ++self.m_value; });
+			});
+	for (auto& producer : producers)
+		producer.join();
+
+	EXPECT_EQ(Actor::Call([](Actor& self) { return self.m_value; }).get(), THREADS * POSTS);
+}
+
+// Scenario: An exception thrown by a called operation is forwarded to the caller.
+
+TEST(ActorSingletonTest, CallForwardsException)
+{
+	using Actor = CounterActor<4>;
+
+	auto result = Actor::Call([](Actor&) -> int { throw std::runtime_error("failure"); });
+
+	EXPECT_THROW(result.get(), std::runtime_error);
+	EXPECT_NO_THROW(Actor::Call([](Actor&) {}).get());
+}
+
+// Scenario: In inline mode, operations run synchronously on the caller's thread.
+
+using InlineActor = CounterActor<5>;
+ACCESS_PRIVATE_STATIC_FUN(InlineActor, void(bool), RunInline);
+
+TEST(ActorSingletonTest, RunInline)
+{
+	call_private_static::InlineActor::RunInline(true);
+
+	std::thread::id executor;
+	InlineActor::Post([&executor](InlineActor& self) {
+			executor = std::this_thread::get_id();
+			self.m_value = 42;
+		});
+
+	EXPECT_EQ(executor, std::this_thread::get_id());
+	auto result = InlineActor::Call([](InlineActor& self) { return self.m_value; });
+	EXPECT_EQ(result.wait_for(std::chrono::seconds(0)), std::future_status::ready);
+	EXPECT_EQ(result.get(), 42);
+
+	call_private_static::InlineActor::RunInline(false);
+}
+
+// Scenario: An injected mock receives the operations instead of the real instance.
+
+template <int testCaseNum>
+struct MockableActor : ActorSingleton<MockableActor<testCaseNum>>
+{
+	virtual int Compute(int value) { return value; }
+};
+
+template <int testCaseNum>
+struct MockMockableActor : MockableActor<testCaseNum>
+{
+	MOCK_METHOD(int, Compute, (int), (override));
+};
+
+using MockableActor1 = MockableActor<1>;
+ACCESS_PRIVATE_STATIC_FUN(MockableActor1, void(MockableActor1*), Inject);
+ACCESS_PRIVATE_STATIC_FUN(MockableActor1, void(bool), RunInline);
+
+TEST(ActorSingletonTest, InjectMock)
+{
+	StrictMock<MockMockableActor<1>> mock;
+	EXPECT_CALL(mock, Compute(3)).Times(1).WillOnce(Return(7));
+
+	call_private_static::MockableActor1::RunInline(true);
+	call_private_static::MockableActor1::Inject(&mock);
+
+	EXPECT_EQ(MockableActor1::Call([](MockableActor1& self) { return self.Compute(3); }).get(), 7);
+
+	call_private_static::MockableActor1::Inject(nullptr);
+
+	EXPECT_EQ(MockableActor1::Call([](MockableActor1& self) { return self.Compute(3); }).get(), 3);
+
+	call_private_static::MockableActor1::RunInline(false);
+}
@@ -0,0 +1,206 @@
+// A small limit, so that oversized payloads are cheap to test.
+#define REMOTE_SINGLETON_MAX_PAYLOAD_SIZE 1024
+
+#include <access_private.hpp>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "../../include/remote_singleton.hpp"
+
+using namespace ::testing;
+
+// Returns a socket path that is unique to the test process.
+std::string GetSocketPath(const char* name)
+{
+	return "/tmp/remote_singleton_test." + std::to_string(getpid()) + "." + name;
+}
+
+// The backend of the echo server used in the tests.
+enum Method : std::uint32_t
+{
+	ECHO,
+	FAIL,
+	FAIL_UNKNOWN,
+	REPEAT,
+};
+
+std::string HandleRequest(std::uint32_t method, const std::string& payload)
+{
+	if (method == FAIL)
+		throw std::runtime_error("Failure: " + payload);
+	if (method == FAIL_UNKNOWN)
+		throw 42;
+	if (method == REPEAT)
+		return std::string(std::stoul(payload), 'x');
+	return "Echo: " + payload;
+}
+
+// A proxy singleton for the backend.
+template <int testCaseNum>
+struct EchoClient : RemoteSingleton<EchoClient<testCaseNum>>
+{
+	virtual std::string Echo(const std::string& text)
+	{
+		return this->CallRemote(ECHO, text).get();
+	}
+
+	std::future<std::string> EchoAsync(const std::string& text)
+	{
+		return this->CallRemote(ECHO, text);
+	}
+
+	std::future<std::string> Fail(const std::string& text)
+	{
+		return this->CallRemote(FAIL, text);
+	}
+
+	std::future<std::string> FailUnknown()
+	{
+		return this->CallRemote(FAIL_UNKNOWN, "");
+	}
+protected:
+	EchoClient() : RemoteSingleton<EchoClient>(GetSocketPath("echo")) {}
+	friend typename EchoClient::BaseType;
+};
+
+// A test fixture that runs the backend while the test is running.
+struct RemoteSingletonTest : Test
+{
+	RemoteServer m_server{ GetSocketPath("echo"), &HandleRequest };
+};
+
+/////////////
+// Test Cases
+
+// Scenario: Calls on the proxy singleton are served by the backend.
+
+TEST_F(RemoteSingletonTest, CallIsServed)
+{
+	EXPECT_EQ(EchoClient<1>::Get().Echo("Hello"), "Echo: Hello");
+	EXPECT_EQ(EchoClient<1>::Get().Echo("World"), "Echo: World");
+}
+
+// Scenario: Many calls from multiple threads are pipelined, and each gets its own response.
+
+TEST_F(RemoteSingletonTest, PipelinedCalls)
+{
+	const int THREADS = 4, CALLS = 1000;
+
+	std::atomic<int> mismatches{ 0 };
+	std::vector<std::thread> callers;
+	for (int t = 0; t < THREADS; ++t)
+		callers.emplace_back([t, &mismatches]() {
+				std::vector<std::future<std::string>> results;
+				for (int i = 0; i < CALLS; ++i)
+					results.push_back(EchoClient<2>::Get().EchoAsync(std::to_string(t * CALLS + i)));
+				for (int i = 0; i < CALLS; ++i)
+					if (results[i].get() != "Echo: " + std::to_string(t * CALLS + i))
+						++mismatches;
+			});
+	for (auto& caller : callers)
+		caller.join();
+
+	EXPECT_EQ(mismatches, 0);
+}
+
+// Scenario: An exception thrown by the backend is forwarded to the caller.
+
+TEST_F(RemoteSingletonTest, FailureIsForwarded)
+{
+	auto result = EchoClient<3>::Get().Fail("Request");
+
+	EXPECT_THROW({
+			try
+			{
+				result.get();
+			}
+			catch (const std::runtime_error& e)
+			{
+				EXPECT_STREQ(e.what(), "Failure: Request");
+				throw;
+			}
+		}, std::runtime_error);
+	EXPECT_EQ(EchoClient<3>::Get().Echo("Again"), "Echo: Again");
+}
+
+// Scenario: An exception of any type thrown by the backend is forwarded, the server survives.
+
+TEST_F(RemoteSingletonTest, UnknownFailureIsForwarded)
+{
+	auto result = EchoClient<6>::Get().FailUnknown();
+
+	EXPECT_THROW(result.get(), std::runtime_error);
+	EXPECT_EQ(EchoClient<6>::Get().Echo("Again"), "Echo: Again");
+}
+
+// Scenario: Oversized requests and responses fail alone, without breaking the connection.
+
+TEST_F(RemoteSingletonTest, OversizedPayloads)
+{
+	RemoteChannel channel(GetSocketPath("echo"));
+
+	auto request = channel.Call(ECHO, std::string(2000, 'x'));
+	auto response = channel.Call(REPEAT, "2000");
+	auto next = channel.Call(REPEAT, "1000");
+
+	EXPECT_THROW(request.get(), std::length_error);
+	EXPECT_THROW(response.get(), std::runtime_error);
+	EXPECT_EQ(next.get(), std::string(1000, 'x'));
+	EXPECT_FALSE(channel.IsBroken());
+}
+
+// Scenario: Calls fail while the backend is stopped, and succeed again after it is restarted.
+
+TEST(RemoteSingletonStandaloneTest, ServerRestarted)
+{
+	std::unique_ptr<RemoteServer> server(new RemoteServer(GetSocketPath("echo"), &HandleRequest));
+	EXPECT_EQ(EchoClient<4>::Get().Echo("Hello"), "Echo: Hello");
+
+	server.reset();
+
+	EXPECT_THROW(EchoClient<4>::Get().Echo("Hello"), std::system_error);
+
+	server.reset(new RemoteServer(GetSocketPath("echo"), &HandleRequest));
+
+	EXPECT_EQ(EchoClient<4>::Get().Echo("Again"), "Echo: Again");
+}
+
+// Scenario: The server keeps serving new clients after the previous ones disconnected.
+
+TEST_F(RemoteSingletonTest, ConnectionsComeAndGo)
+{
+	for (int i = 0; i < 100; ++i)
+	{
+		RemoteChannel channel(GetSocketPath("echo"));
+		EXPECT_EQ(channel.Call(ECHO, std::to_string(i)).get(), "Echo: " + std::to_string(i));
+	}
+}
+
+// Scenario: An in-process stand-in can be injected without a running backend.
+
+template <int testCaseNum>
+struct EchoStandIn : EchoClient<testCaseNum>
+{
+	std::string Echo(const std::string& text) override
+	{
+		return "Local: " + text;
+	}
+};
+
+using EchoClient5 = EchoClient<5>;
+ACCESS_PRIVATE_STATIC_FUN(EchoClient5, void(EchoClient5*), Inject);
+
+TEST(RemoteSingletonStandaloneTest, InjectStandIn)
+{
+	EchoStandIn<5> standIn;
+
+	call_private_static::EchoClient5::Inject(&standIn);
+
+	EXPECT_EQ(EchoClient5::Get().Echo("Hello"), "Local: Hello");
+}
@@ -0,0 +1,191 @@
+#include <access_private.hpp>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include <sys/time.h>
+
+#include "../../include/singleton.hpp"
+#include "../../include/singleton_fork_gtest.hpp"
+
+using namespace ::testing;
+
+// This test program runs every test in a forked child process with `RunAllTestsForked()`. The
+// parent constructs the expensive singleton before forking the tests (see `main()` below).
+
+struct ExpensiveSingleton : Singleton<ExpensiveSingleton>
+{
+	static constexpr int INITIAL_VALUE = 1234;
+	static int g_constructions;
+
+	pid_t m_constructorPid = getpid();
+	int m_value = INITIAL_VALUE;
+
+	ExpensiveSingleton() { ++g_constructions; }
+};
+constexpr int ExpensiveSingleton::INITIAL_VALUE;
+int ExpensiveSingleton::g_constructions = 0;
+ACCESS_PRIVATE_STATIC_FUN(ExpensiveSingleton, ExpensiveSingleton& (), Reset);
+ACCESS_PRIVATE_STATIC_FUN(ExpensiveSingleton, void(ExpensiveSingleton*), Inject);
+
+/////////////
+// Test Cases
+
+// Scenario: The tests receive the singleton constructed by the parent process.
+
+TEST(ForkedSingletonTest, ConstructedByParent)
+{
+	auto inst = ExpensiveSingleton::TryGet();
+
+	ASSERT_NE(inst, nullptr);
+	EXPECT_NE(inst->m_constructorPid, getpid());
+	EXPECT_EQ(ExpensiveSingleton::g_constructions, 1);
+}
+
+// Scenario: Changes to the singleton in one test are not seen by the other tests.
+
+TEST(ForkedSingletonTest, ModifiesState)
+{
+	ExpensiveSingleton::Get().m_value = 42;
+
+	EXPECT_EQ(ExpensiveSingleton::Get().m_value, 42);
+}
+
+TEST(ForkedSingletonTest, StateIsPristine)
+{
+	EXPECT_EQ(ExpensiveSingleton::Get().m_value, ExpensiveSingleton::INITIAL_VALUE);
+}
+
+// Scenario: Reset and Inject work as usual within the tests.
+
+TEST(ForkedSingletonTest, ResetInTest)
+{
+	auto& inst = call_private_static::ExpensiveSingleton::Reset();
+
+	EXPECT_EQ(inst.m_constructorPid, getpid());
+	EXPECT_EQ(ExpensiveSingleton::g_constructions, 2);
+}
+
+TEST(ForkedSingletonTest, InjectInTest)
+{
+	ExpensiveSingleton mock;
+	mock.m_value = 0;
+
+	call_private_static::ExpensiveSingleton::Inject(&mock);
+
+	EXPECT_EQ(&ExpensiveSingleton::Get(), &mock);
+	EXPECT_EQ(ExpensiveSingleton::Get().m_value, 0);
+}
+
+// Scenario: The runner reports the exit code, the signal and the output of each test.
+
+TEST(SingletonForkRunnerTest, ReportsResults)
+{
+	auto results = SingletonForkRunner::Run({ "pass", "fail", "crash" },
+		[](const std::string& test) {
+			std::printf("Running %s", test.c_str());
+			if (test == "fail")
+				return 3;
+			if (test == "crash")
+				std::raise(SIGKILL);
+			return 0;
+		}, 2);
+
+	ASSERT_EQ(results.size(), 3u);
+	EXPECT_EQ(results[0].test, "pass");
+	EXPECT_TRUE(results[0].Passed());
+	EXPECT_EQ(results[0].output, "Running pass");
+	EXPECT_FALSE(results[1].Passed());
+	EXPECT_EQ(results[1].exitCode, 3);
+	EXPECT_EQ(results[1].output, "Running fail");
+	EXPECT_FALSE(results[2].Passed());
+	EXPECT_EQ(results[2].signal, SIGKILL);
+}
+
+// Scenario: The results are reported as soon as each child exits.
+
+TEST(SingletonForkRunnerTest, StreamsResults)
+{
+	std::vector<std::string> completed;
+	auto results = SingletonForkRunner::Run({ "slow", "fast" },
+		[](const std::string& test) {
+			if (test == "slow")
+				usleep(200 * 1000);
+			return 0;
+		}, 2, [&completed](const SingletonForkRunner::Result& result) {
+			completed.push_back(result.test);
+		});
+
+	ASSERT_EQ(results.size(), 2u);
+	EXPECT_EQ(results[0].test, "slow");
+	EXPECT_THAT(completed, ElementsAre("fast", "slow"));
+}
+
+// Scenario: Other children of the test program are not reaped by the runner.
+
+TEST(SingletonForkRunnerTest, IgnoresOtherChildren)
+{
+	pid_t other = fork();
+	ASSERT_NE(other, -1);
+	if (other == 0)
+		_exit(7);
+
+	auto results = SingletonForkRunner::Run({ "test" },
+		[](const std::string&) {
+			usleep(100 * 1000);
+			return 0;
+		});
+
+	int status = 0;
+	ASSERT_EQ(waitpid(other, &status, 0), other);
+	EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 7);
+	ASSERT_EQ(results.size(), 1u);
+	EXPECT_TRUE(results[0].Passed());
+}
+
+// Scenario: Signals interrupting the wait do not abort the run.
+
+TEST(SingletonForkRunnerTest, SurvivesInterrupts)
+{
+	struct sigaction action = {};
+	action.sa_handler = [](int) {};
+	ASSERT_EQ(sigaction(SIGALRM, &action, nullptr), 0);
+	itimerval timer = { { 0, 1000 }, { 0, 1000 } };
+	ASSERT_EQ(setitimer(ITIMER_REAL, &timer, nullptr), 0);
+
+	auto results = SingletonForkRunner::Run({ "first", "second" },
+		[](const std::string&) {
+			usleep(50 * 1000);
+			return 0;
+		});
+
+	timer = {};
+	setitimer(ITIMER_REAL, &timer, nullptr);
+	ASSERT_EQ(results.size(), 2u);
+	EXPECT_TRUE(results[0].Passed());
+	EXPECT_TRUE(results[1].Passed());
+}
+
+// Scenario: Test names are selected with Google Test style filters.
+
+TEST(SingletonForkRunnerTest, MatchesFilter)
+{
+	EXPECT_TRUE(SingletonForkRunner::MatchesFilter("Suite.Test", "*"));
+	EXPECT_TRUE(SingletonForkRunner::MatchesFilter("Suite.Test", "Other.*:Suite.*"));
+	EXPECT_TRUE(SingletonForkRunner::MatchesFilter("Suite.Test", "Suite.T?st"));
+	EXPECT_TRUE(SingletonForkRunner::MatchesFilter("Suite.Test", "-Other.*"));
+	EXPECT_FALSE(SingletonForkRunner::MatchesFilter("Suite.Test", "Other.*"));
+	EXPECT_FALSE(SingletonForkRunner::MatchesFilter("Suite.Test", "Suite.*-*.Test"));
+}
+
+int main(int argc, char** argv)
+{
+	::testing::InitGoogleTest(&argc, argv);
+	ExpensiveSingleton::Get();
+	return RunAllTestsForked(2);
+}
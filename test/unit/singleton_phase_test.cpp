@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <string>
+#include <typeinfo>
+
+#include "../../include/singleton.hpp"
+#if defined(__has_include)
+#if __has_include(<execinfo.h>)
+#include "../../include/singleton_phase_backtrace.hpp"
+#define TEST_PHASE_BACKTRACE 1
+#endif
+#endif
+
+using namespace ::testing;
+
+// A test fixture that leaves the serving phase and restores the default handler after the test.
+struct SingletonPhaseTest : Test
+{
+	~SingletonPhaseTest()
+	{
+		SingletonPhase::LeaveServingPhase();
+		SingletonPhase::SetHandler(nullptr);
+	}
+};
+
+template <int testCaseNum>
+struct PhasedSingleton : Singleton<PhasedSingleton<testCaseNum>>
+{
+};
+
+/////////////
+// Test Cases
+
+// Scenario: Constructions are only counted in the serving phase.
+
+TEST_F(SingletonPhaseTest, CountsConstructionsWhileServing)
+{
+	auto initialCount = SingletonPhase::GetColdConstructions();
+
+	PhasedSingleton<1>::Get();
+
+	EXPECT_FALSE(SingletonPhase::IsServing());
+	EXPECT_EQ(SingletonPhase::GetColdConstructions(), initialCount);
+
+	SingletonPhase::EnterServingPhase(SingletonPhase::COUNT);
+	PhasedSingleton<1>::Get();
+	PhasedSingleton<2>::Get();
+	PhasedSingleton<2>::Get();
+
+	EXPECT_TRUE(SingletonPhase::IsServing());
+	EXPECT_EQ(SingletonPhase::GetColdConstructions(), initialCount + 1);
+
+	SingletonPhase::LeaveServingPhase();
+	PhasedSingleton<3>::Get();
+
+	EXPECT_EQ(SingletonPhase::GetColdConstructions(), initialCount + 1);
+}
+
+// Scenario: With the LOG policy, the handler receives the constructed type and the call site.
+
+std::string g_reportedType;
+const void* g_reportedCallSite = nullptr;
+
+TEST_F(SingletonPhaseTest, LogPolicyCallsHandler)
+{
+	SingletonPhase::SetHandler([](const char* typeName, const void* callSite) {
+			g_reportedType = typeName;
+			g_reportedCallSite = callSite;
+		});
+	SingletonPhase::EnterServingPhase(SingletonPhase::LOG);
+
+	PhasedSingleton<4>::Get();
+
+	EXPECT_EQ(g_reportedType, typeid(PhasedSingleton<4>).name());
+#if defined(__GNUC__) || defined(_MSC_VER)
+	EXPECT_NE(g_reportedCallSite, nullptr);
+#endif
+}
+
+// Scenario: The default handler prints the singleton with the FATAL policy, then aborts.
+
+TEST_F(SingletonPhaseTest, FatalPolicyAborts)
+{
+	EXPECT_DEATH({
+			SingletonPhase::EnterServingPhase(SingletonPhase::FATAL);
+			PhasedSingleton<5>::Get();
+		}, "serving phase.*PhasedSingleton.*called from");
+}
+
+#ifdef TEST_PHASE_BACKTRACE
+// Scenario: The backtrace handler prints the call stack of the construction.
+
+TEST_F(SingletonPhaseTest, BacktraceHandler)
+{
+	EXPECT_DEATH({
+			SingletonPhase::SetHandler(&SingletonPhaseBacktrace::Log);
+			SingletonPhase::EnterServingPhase(SingletonPhase::FATAL);
+			PhasedSingleton<6>::Get();
+		}, "serving phase.*PhasedSingleton.*called from.*\n.+");
+}
+#endif
@@ -0,0 +1,222 @@
+#ifndef SINGLETON_REALMS
+#define SINGLETON_REALMS
+#endif
+
+#include <access_private.hpp>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include "../../include/singleton.hpp"
+
+using namespace ::testing;
+
+/////////////
+// Test Cases
+
+// Scenario: Each realm has its own instance, separate from the instance outside of realms.
+
+template <int testCaseNum>
+struct RealmSingleton : Singleton<RealmSingleton<testCaseNum>>
+{
+	int m_value = 0;
+};
+
+TEST(SingletonRealmTest, RealmsHaveSeparateInstances)
+{
+	using SingletonType = RealmSingleton<1>;
+	SingletonRealm realm1, realm2;
+
+	auto global = &SingletonType::Get();
+	SingletonType* inRealm1 = nullptr;
+	SingletonType* inRealm2 = nullptr;
+	{
+		SingletonRealm::Scope scope(realm1);
+		inRealm1 = &SingletonType::Get();
+
+		EXPECT_EQ(SingletonRealm::GetCurrent(), &realm1);
+		EXPECT_EQ(&SingletonType::Get(), inRealm1);
+		{
+			SingletonRealm::Scope nestedScope(realm2);
+			inRealm2 = &SingletonType::Get();
+		}
+		EXPECT_EQ(&SingletonType::Get(), inRealm1);
+	}
+
+	EXPECT_EQ(SingletonRealm::GetCurrent(), nullptr);
+	EXPECT_EQ(&SingletonType::Get(), global);
+	EXPECT_NE(inRealm1, global);
+	EXPECT_NE(inRealm2, global);
+	EXPECT_NE(inRealm1, inRealm2);
+}
+
+// Scenario: TryGet returns the instance of the current realm, or nullptr if unconstructed.
+
+TEST(SingletonRealmTest, TryGetInRealm)
+{
+	using SingletonType = RealmSingleton<2>;
+	SingletonRealm realm;
+	SingletonRealm::Scope scope(realm);
+
+	EXPECT_EQ(SingletonType::TryGet(), nullptr);
+
+	auto& inst = SingletonType::Get();
+
+	EXPECT_EQ(SingletonType::TryGet(), &inst);
+}
+
+// Scenario: Threads bound to the same realm share its instances, other realms are isolated.
+
+struct CounterSingleton : Singleton<CounterSingleton>
+{
+	std::atomic<int> m_count{ 0 };
+};
+
+TEST(SingletonRealmTest, ThreadsShareTheirRealm)
+{
+	const int REALMS = 4, THREADS_PER_REALM = 4, INCREMENTS = 1000;
+	std::vector<SingletonRealm*> realms;
+	for (int i = 0; i < REALMS; ++i)
+		realms.push_back(new SingletonRealm());
+
+	std::vector<std::thread> threads;
+	for (int i = 0; i < REALMS * THREADS_PER_REALM; ++i)
+		threads.emplace_back([&realms, i]() {
+				SingletonRealm::Scope scope(*realms[i % REALMS]);
+				for (int j = 0; j < INCREMENTS; ++j)
+					++CounterSingleton::Get().m_count;
+			});
+	for (auto& thread : threads)
+		thread.join();
+
+	for (auto realm : realms)
+	{
+		SingletonRealm::Scope scope(*realm);
+		EXPECT_EQ(CounterSingleton::Get().m_count, THREADS_PER_REALM * INCREMENTS);
+	}
+	EXPECT_EQ(CounterSingleton::TryGet(), nullptr);
+	for (auto realm : realms)
+		delete realm;
+}
+
+// Scenario: Singletons used by constructors resolve to the realm of the outer singleton, and the
+// instances are destroyed in reverse order with the realm.
+
+std::vector<int> g_destructionOrder;
+
+template <int testCaseNum>
+struct OrderedSingleton : Singleton<OrderedSingleton<testCaseNum>>
+{
+	OrderedSingleton(int id = testCaseNum) : m_id(id) {}
+	~OrderedSingleton() { g_destructionOrder.push_back(m_id); }
+	int m_id;
+};
+
+struct OuterSingleton : Singleton<OuterSingleton>
+{
+	OuterSingleton() : m_inner(&OrderedSingleton<1>::Get()) {}
+	~OuterSingleton() { g_destructionOrder.push_back(0); }
+	OrderedSingleton<1>* m_inner;
+};
+
+TEST(SingletonRealmTest, NestedConstructionAndDestruction)
+{
+	g_destructionOrder.clear();
+	{
+		SingletonRealm realm;
+		SingletonRealm::Scope scope(realm);
+
+		auto& outer = OuterSingleton::Get();
+		OrderedSingleton<2>::Get(42);
+
+		EXPECT_EQ(outer.m_inner, &OrderedSingleton<1>::Get());
+		EXPECT_EQ(OrderedSingleton<2>::Get().m_id, 42);
+	}
+
+	EXPECT_THAT(g_destructionOrder, ElementsAre(42, 0, 1));
+}
+
+// Scenario: Injecting into the singleton does not affect the instances of realms.
+
+using RealmSingleton5 = RealmSingleton<5>;
+ACCESS_PRIVATE_STATIC_FUN(RealmSingleton5, void(RealmSingleton5*), Inject);
+
+TEST(SingletonRealmTest, InjectOutsideOfRealms)
+{
+	SingletonRealm realm;
+	RealmSingleton5 mock;
+
+	call_private_static::RealmSingleton5::Inject(&mock);
+	SingletonRealm::Scope scope(realm);
+
+	EXPECT_NE(&RealmSingleton5::Get(), &mock);
+}
+
+// Scenario: A realm can be created for a NUMA node, even if the system is not NUMA-aware.
+
+TEST(SingletonRealmTest, NumaNodeRealm)
+{
+	SingletonRealm realm(0);
+	SingletonRealm::Scope scope(realm);
+
+	EXPECT_EQ(realm.GetNumaNode(), 0);
+	RealmSingleton<6>::Get().m_value = 6;
+	EXPECT_EQ(RealmSingleton<6>::Get().m_value, 6);
+}
+
+// Scenario: A realm reports whether its memory could be bound to its NUMA node.
+
+TEST(SingletonRealmTest, NumaBinding)
+{
+	SingletonRealm unbound;
+	SingletonRealm missingNode(1 << 20);
+
+	EXPECT_FALSE(unbound.IsNumaBound());
+	EXPECT_FALSE(missingNode.IsNumaBound());
+	EXPECT_EQ(missingNode.GetNumaNode(), 1 << 20);
+}
+
+// Scenario: Over-aligned singletons are aligned in the memory of the realm.
+
+template <int testCaseNum>
+struct alignas(64) AlignedSingleton : Singleton<AlignedSingleton<testCaseNum>>
+{
+	char m_value = 0;
+};
+
+TEST(SingletonRealmTest, OverAlignedInstances)
+{
+	SingletonRealm realm;
+	SingletonRealm::Scope scope(realm);
+
+	RealmSingleton<7>::Get();
+	auto first = reinterpret_cast<std::uintptr_t>(&AlignedSingleton<1>::Get());
+	RealmSingleton<8>::Get();
+	auto second = reinterpret_cast<std::uintptr_t>(&AlignedSingleton<2>::Get());
+
+	EXPECT_EQ(first % 64, 0u);
+	EXPECT_EQ(second % 64, 0u);
+}
+
+// Scenario: Resetting the singleton within a realm reconstructs the instance outside of realms.
+
+using RealmSingleton9 = RealmSingleton<9>;
+ACCESS_PRIVATE_STATIC_FUN(RealmSingleton9, RealmSingleton9&(), Reset);
+
+TEST(SingletonRealmTest, ResetOutsideOfRealms)
+{
+	SingletonRealm realm;
+	RealmSingleton9::Get().m_value = 1;
+	SingletonRealm::Scope scope(realm);
+	RealmSingleton9::Get().m_value = 2;
+
+	auto& reset = call_private_static::RealmSingleton9::Reset();
+
+	EXPECT_EQ(reset.m_value, 0);
+	EXPECT_NE(&reset, &RealmSingleton9::Get());
+	EXPECT_EQ(RealmSingleton9::Get().m_value, 2);
+}
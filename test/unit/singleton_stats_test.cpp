@@ -0,0 +1,166 @@
+#ifndef SINGLETON_STATS
+#define SINGLETON_STATS
+#endif
+
+#include <access_private.hpp>
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+#include <typeinfo>
+
+#include <sys/wait.h>
+
+#include "../../include/singleton.hpp"
+
+using namespace ::testing;
+
+// Returns the published entry of the singleton type `T` on the statistics page, if any.
+template <typename T>
+const SingletonStats::Entry* FindEntry()
+{
+	const SingletonStats::Page& page = SingletonStats::GetPage();
+	for (std::uint32_t i = 0; i < page.count.load() && i < page.capacity; ++i)
+	{
+		const SingletonStats::Entry& entry = page.entries[i];
+		if (entry.published.load() && std::strcmp(entry.typeName, typeid(T).name()) == 0)
+			return &entry;
+	}
+	return nullptr;
+}
+
+/////////////
+// Test Cases
+
+// Scenario: A constructed singleton is listed on the page with its size and construction time.
+
+template <int testCaseNum>
+struct StatsSingleton : Singleton<StatsSingleton<testCaseNum>>
+{
+	char m_payload[100];
+};
+
+TEST(SingletonStatsTest, ConstructedSingletonIsListed)
+{
+	using SingletonType = StatsSingleton<1>;
+
+	EXPECT_EQ(FindEntry<SingletonType>(), nullptr);
+
+	SingletonType::Get();
+
+	auto entry = FindEntry<SingletonType>();
+	ASSERT_NE(entry, nullptr);
+	EXPECT_EQ(entry->state.load(), SingletonStats::LOCAL);
+	EXPECT_EQ(entry->size, sizeof(SingletonType));
+	EXPECT_EQ(entry->waiters.load(), 0u);
+	EXPECT_NE(entry->constructedAt.load(), 0u);
+}
+
+// Scenario: The page is readable as a shared memory object named after the process.
+
+TEST(SingletonStatsTest, PageIsShared)
+{
+	StatsSingleton<2>::Get();
+
+	char name[64];
+	SingletonStats::GetPageName(static_cast<long>(getpid()), name);
+	int fd = shm_open(name, O_RDONLY, 0);
+	ASSERT_NE(fd, -1);
+	void* addr = mmap(nullptr, sizeof(SingletonStats::Page), PROT_READ, MAP_SHARED, fd, 0);
+	close(fd);
+	ASSERT_NE(addr, MAP_FAILED);
+
+	auto& page = *static_cast<const SingletonStats::Page*>(addr);
+	EXPECT_EQ(page.magic, SingletonStats::MAGIC);
+	EXPECT_EQ(page.count.load(), SingletonStats::GetPage().count.load());
+	EXPECT_EQ(
+		page.entries[0].state.load(), SingletonStats::GetPage().entries[0].state.load());
+
+	munmap(addr, sizeof(SingletonStats::Page));
+}
+
+// Scenario: Injecting an instance and resetting the singleton are reflected in its state.
+
+using StatsSingleton3 = StatsSingleton<3>;
+ACCESS_PRIVATE_STATIC_FUN(StatsSingleton3, void(StatsSingleton3*), Inject);
+ACCESS_PRIVATE_STATIC_FUN(StatsSingleton3, StatsSingleton3& (), Reset);
+
+TEST(SingletonStatsTest, InjectAndResetUpdateState)
+{
+	struct MockOfSingleton : StatsSingleton3 {} mock;
+
+	call_private_static::StatsSingleton3::Inject(&mock);
+
+	auto entry = FindEntry<StatsSingleton3>();
+	ASSERT_NE(entry, nullptr);
+	EXPECT_EQ(entry->state.load(), SingletonStats::INJECTED);
+
+	call_private_static::StatsSingleton3::Inject(nullptr);
+
+	EXPECT_EQ(entry->state.load(), SingletonStats::UNINITIALIZED);
+
+	call_private_static::StatsSingleton3::Reset();
+
+	EXPECT_EQ(entry->state.load(), SingletonStats::LOCAL);
+}
+
+// Scenario: A forked child does not overwrite the states published by the parent.
+
+using StatsSingleton4 = StatsSingleton<4>;
+ACCESS_PRIVATE_STATIC_FUN(StatsSingleton4, void(StatsSingleton4*), Inject);
+
+TEST(SingletonStatsTest, ForkedChildHasPrivatePage)
+{
+	StatsSingleton4::Get();
+	auto entry = FindEntry<StatsSingleton4>();
+	ASSERT_NE(entry, nullptr);
+
+	pid_t pid = fork();
+	ASSERT_NE(pid, -1);
+	if (pid == 0)
+	{
+		StatsSingleton4 mock;
+		call_private_static::StatsSingleton4::Inject(&mock);
+		_exit(entry->state.load() == SingletonStats::INJECTED ? 0 : 1);
+	}
+	int status = 0;
+	ASSERT_EQ(waitpid(pid, &status, 0), pid);
+
+	EXPECT_TRUE(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+	EXPECT_EQ(entry->state.load(), SingletonStats::LOCAL);
+}
+
+// Scenario: Threads blocked on a singleton under construction are counted as waiters.
+
+struct SlowSingleton : Singleton<SlowSingleton>
+{
+	static std::atomic<bool> g_release;
+
+	SlowSingleton()
+	{
+		while (!g_release)
+			std::this_thread::yield();
+	}
+};
+std::atomic<bool> SlowSingleton::g_release{ false };
+
+TEST(SingletonStatsTest, WaitersAreCounted)
+{
+	std::thread constructor([]() { SlowSingleton::Get(); });
+	const SingletonStats::Entry* entry = nullptr;
+	while (!entry || entry->state.load() != SingletonStats::CONSTRUCTING)
+		entry = FindEntry<SlowSingleton>();
+
+	std::thread waiter([]() { SlowSingleton::Get(); });
+	while (entry->waiters.load() != 1)
+		std::this_thread::yield();
+
+	SlowSingleton::g_release = true;
+	constructor.join();
+	waiter.join();
+
+	EXPECT_EQ(entry->state.load(), SingletonStats::LOCAL);
+	EXPECT_EQ(entry->waiters.load(), 0u);
+}
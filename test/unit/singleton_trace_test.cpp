@@ -0,0 +1,156 @@
+#ifndef SINGLETON_TRACE
+#define SINGLETON_TRACE
+#endif
+// The statistics are used to wait until a thread is blocked on a construction.
+#ifndef SINGLETON_STATS
+#define SINGLETON_STATS
+#endif
+
+#include <gtest/gtest.h>
+#include <gmock/gmock.h>
+
+#include <atomic>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <typeinfo>
+
+#include "../../include/singleton.hpp"
+
+using namespace ::testing;
+
+// A recorded trace event, as parsed back from the written file.
+struct TraceEvent
+{
+	double ts = -1, dur = -1;
+	unsigned tid = 0;
+};
+
+// Writes the recorded trace into a file, and returns its contents.
+std::string WriteTrace()
+{
+	const char* path = "singleton_trace_test.json";
+	EXPECT_TRUE(SingletonTrace::Write(path));
+	std::ifstream file(path);
+	std::stringstream contents;
+	contents << file.rdbuf();
+	std::remove(path);
+	return contents.str();
+}
+
+// Finds the event with `name` in a written trace.
+TraceEvent FindEvent(const std::string& trace, const std::string& name)
+{
+	TraceEvent event;
+	auto pos = trace.find("{\"name\":\"" + name + "\"");
+	if (pos != std::string::npos)
+	{
+		auto ts = trace.find("\"ts\":", pos);
+		std::sscanf(trace.c_str() + ts, "\"ts\":%lf,\"dur\":%lf,\"pid\":1,\"tid\":%u",
+			&event.ts, &event.dur, &event.tid);
+	}
+	return event;
+}
+
+/////////////
+// Test Cases
+
+// Scenario: Nested constructions are recorded as nested intervals on the same thread.
+
+struct InnerSingleton : Singleton<InnerSingleton>
+{
+};
+
+struct OuterSingleton : Singleton<OuterSingleton>
+{
+	OuterSingleton()
+	{
+		InnerSingleton::Get();
+	}
+};
+
+struct UntracedSingleton : Singleton<UntracedSingleton>
+{
+};
+
+TEST(SingletonTraceTest, NestedConstruction)
+{
+	UntracedSingleton::Get();
+
+	SingletonTrace::Start();
+	OuterSingleton::Get();
+	SingletonTrace::Stop();
+
+	auto trace = WriteTrace();
+	auto outer = FindEvent(trace, "OuterSingleton");
+	auto inner = FindEvent(trace, "InnerSingleton");
+
+	EXPECT_THAT(trace, HasSubstr("\"traceEvents\":["));
+	EXPECT_THAT(trace, Not(HasSubstr("UntracedSingleton")));
+	ASSERT_GE(outer.ts, 0);
+	ASSERT_GE(inner.ts, 0);
+	EXPECT_EQ(outer.tid, inner.tid);
+	EXPECT_LE(outer.ts, inner.ts);
+	EXPECT_GE(outer.ts + outer.dur, inner.ts + inner.dur);
+}
+
+// Scenario: A thread blocked on a singleton under construction records a wait interval.
+
+struct SlowSingleton : Singleton<SlowSingleton>
+{
+	static std::atomic<bool> g_release;
+
+	SlowSingleton()
+	{
+		while (!g_release)
+			std::this_thread::yield();
+	}
+};
+std::atomic<bool> SlowSingleton::g_release{ false };
+
+// Returns the statistics entry of a singleton type, once it is registered.
+template <typename T>
+const SingletonStats::Entry& WaitForStats()
+{
+	const SingletonStats::Page& page = SingletonStats::GetPage();
+	for (;;)
+	{
+		for (std::uint32_t i = 0; i < page.count.load() && i < page.capacity; ++i)
+		{
+			const SingletonStats::Entry& entry = page.entries[i];
+			if (entry.published.load() && std::strcmp(entry.typeName, typeid(T).name()) == 0)
+				return entry;
+		}
+		std::this_thread::yield();
+	}
+}
+
+TEST(SingletonTraceTest, BlockedWaiter)
+{
+	SingletonTrace::Start();
+	std::thread constructor([]() { SlowSingleton::Get(); });
+	const SingletonStats::Entry& stats = WaitForStats<SlowSingleton>();
+	while (stats.state.load() != SingletonStats::CONSTRUCTING)
+		std::this_thread::yield();
+	std::thread waiter([]() { SlowSingleton::Get(); });
+	// The waiter is counted after it took the start time of its wait.
+	while (stats.waiters.load() != 1)
+		std::this_thread::yield();
+	SlowSingleton::g_release = true;
+	constructor.join();
+	waiter.join();
+	SingletonTrace::Stop();
+
+	auto trace = WriteTrace();
+	auto construction = FindEvent(trace, "SlowSingleton");
+	auto wait = FindEvent(trace, "wait: SlowSingleton");
+
+	ASSERT_GE(construction.ts, 0);
+	ASSERT_GE(wait.ts, 0);
+	EXPECT_NE(construction.tid, wait.tid);
+	EXPECT_LE(wait.ts, construction.ts + construction.dur);
+	EXPECT_GE(wait.ts + wait.dur, construction.ts + construction.dur);
+}
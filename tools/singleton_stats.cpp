@@ -0,0 +1,110 @@
+// Prints the singleton statistics page of a process that is built with `SINGLETON_STATS`.
+//
+// Usage: singleton_stats <pid>
+
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#if defined(__GNUG__)
+#include <cxxabi.h>
+#endif
+
+#include "../include/singleton_stats.hpp"
+
+namespace
+{
+
+const char* StateName(std::uint32_t state)
+{
+    switch (state)
+    {
+    case SingletonStats::UNINITIALIZED: return "uninitialized";
+    case SingletonStats::CONSTRUCTING: return "constructing";
+    case SingletonStats::LOCAL: return "local";
+    case SingletonStats::INJECTED: return "injected";
+    default: return "unknown";
+    }
+}
+
+void PrintEntry(const SingletonStats::Entry& entry)
+{
+    char typeName[SingletonStats::NAME_SIZE];
+    std::memcpy(typeName, entry.typeName, sizeof(typeName));
+    typeName[sizeof(typeName) - 1] = '\0';
+
+    char* demangled = nullptr;
+#if defined(__GNUG__)
+    int status = 0;
+    demangled = abi::__cxa_demangle(typeName, nullptr, nullptr, &status);
+#endif
+
+    char constructedAt[32] = "-";
+    std::uint64_t at = entry.constructedAt.load(std::memory_order_relaxed);
+    if (at)
+    {
+        std::time_t seconds = static_cast<std::time_t>(at / 1000000000u);
+        std::strftime(constructedAt, sizeof(constructedAt), "%Y-%m-%d %H:%M:%S",
+            std::localtime(&seconds));
+    }
+
+    std::printf("%-14s %7u %10llu %19s %12.3f  %s\n",
+        StateName(entry.state.load(std::memory_order_relaxed)),
+        entry.waiters.load(std::memory_order_relaxed),
+        static_cast<unsigned long long>(entry.size),
+        constructedAt,
+        entry.constructionTime.load(std::memory_order_relaxed) / 1e6,
+        demangled ? demangled : typeName);
+    std::free(demangled);
+}
+
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 2)
+    {
+        std::fprintf(stderr, "Usage: %s <pid>\n", argv[0]);
+        return 2;
+    }
+
+    char name[64];
+    SingletonStats::GetPageName(std::strtol(argv[1], nullptr, 10), name);
+    int fd = shm_open(name, O_RDONLY, 0);
+    if (fd == -1)
+    {
+        std::perror(name);
+        return 1;
+    }
+    void* addr = mmap(nullptr, sizeof(SingletonStats::Page), PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (addr == MAP_FAILED)
+    {
+        std::perror("mmap");
+        return 1;
+    }
+
+    const SingletonStats::Page& page = *static_cast<const SingletonStats::Page*>(addr);
+    if (page.magic != SingletonStats::MAGIC || page.version != SingletonStats::VERSION)
+    {
+        std::fprintf(stderr, "%s: unsupported page format\n", name);
+        return 1;
+    }
+
+    std::uint32_t count = page.count.load(std::memory_order_relaxed);
+    std::printf("%-14s %7s %10s %19s %12s  %s\n",
+        "STATE", "WAITERS", "SIZE", "CONSTRUCTED AT", "DURATION(ms)", "TYPE");
+    for (std::uint32_t i = 0; i < count && i < page.capacity; ++i)
+    {
+        const SingletonStats::Entry& entry = page.entries[i];
+        if (entry.published.load(std::memory_order_acquire))
+            PrintEntry(entry);
+    }
+    if (count > page.capacity)
+        std::printf("(%u singletons are not listed, the page is full)\n", count - page.capacity);
+    return 0;
+}